@@ -5,8 +5,21 @@ args="${@:1}"
 
 if [[ "$arg" == 'web' ]]; then
     make PLATFORM=PLATFORM_WEB ${args:3}
-    cd ./build/Wasm
-    python3 -m http.server
+    if [[ "$args" == *WEB_THREADS=1* ]]; then
+        # threads need SharedArrayBuffer, which the browser only gives a cross origin isolated page
+        cd ./build/WasmThreads
+        python3 -c '
+from http.server import SimpleHTTPRequestHandler, test
+class Isolated(SimpleHTTPRequestHandler):
+    def end_headers(self):
+        self.send_header("Cross-Origin-Opener-Policy", "same-origin")
+        self.send_header("Cross-Origin-Embedder-Policy", "require-corp")
+        super().end_headers()
+test(Isolated)'
+    else
+        cd ./build/Wasm
+        python3 -m http.server
+    fi
 else
     make $args
     ./build/Darwin/cand
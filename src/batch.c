@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "scenes.h"
+#include "snapshot.h"
+
+// Headless batch runner, steps many small independent worlds at once
+//   usage: batch <jobs|-> [threads]
+//   every line of jobs (- reads stdin) is one or more worlds, # starts a comment:
+//     <scene|world.snap> <seed|first-last|-> <ticks> [width height]
+//   a range of seeds is a world per seed, - keeps a snapshot's own seed. Scenes
+//   are width x height cells (BATCH_W x BATCH_H without), snapshots their own size.
+//   Every world is stepped serially, start to end on one thread, and the threads
+//   take the next world as they finish one, so the worlds in flight are one per
+//   thread and small enough to stay in its cache. Prints the final hash, the
+//   cells of every material and the time of each world, in the order of the jobs
+
+// 256 x 192 cells is ~200 KiB of step state (see world_kib), it fits an L2
+#define BATCH_W 256
+#define BATCH_H 192
+
+typedef struct Job {
+    const Scene *scene; // NULL for a snapshot
+    char path[256];
+    u64 seed;
+    bool own_seed;      // a snapshot stepped with the seed it was saved with
+    u32 ticks;
+    u32 width, height;
+
+    // filled in by run_job
+    bool ok;
+    u64 hash;
+    u32 pop[MATERIALS_LEN];
+    f64 ms;
+    f64 kib;
+} Job;
+
+typedef struct Batch {
+    Job *jobs;
+    u32 len;
+    u32 cap;
+    u32 *order;         // the jobs biggest first, so a long one doesn't start last
+} Batch;
+
+static f64 now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+
+// what the step reads and writes for the grid
+static f64 world_kib(const Grid *grid) {
+    const size_t cells = (size_t)grid->len * (sizeof(u8) * 2 + sizeof(u16)) + (grid->len + 63) / 64 * sizeof(u64);
+    const size_t gas = (size_t)gas_stride(&grid->gas) * (grid->gas.h + 2) * sizeof(u16) * 3;
+    return (f64)(cells + gas + grid->chunks.len * 2) / 1024.0;
+}
+
+static void run_job(void *arg, const u32 i) {
+    Batch *batch = arg;
+    Job *job = &batch->jobs[batch->order[i]];
+
+    Grid grid = job->scene ? new_grid((i32)job->width, (i32)job->height, 1) : new_grid(BATCH_W, BATCH_H, 1);
+    // the batch is already one world per thread
+    grid.cores = 1;
+    if (!grid.len || (!job->scene && !load_snapshot(&grid, job->path))) {
+        free_grid(&grid);
+        return;
+    }
+    if (job->scene || !job->own_seed) grid.seed = job->seed;
+
+    const f64 start = now_sec();
+    if (job->scene) job->scene->init(&grid);
+    for (u32 t = 0; t < job->ticks; ++t) {
+        if (job->scene) job->scene->tick(&grid, t);
+        update_gravity(&grid);
+    }
+    job->ms = (now_sec() - start) * 1e3;
+
+    job->ok   = true;
+    job->seed = grid.seed;
+    job->hash = hash_grid(&grid);
+    job->kib  = world_kib(&grid);
+    job->width  = grid.width;
+    job->height = grid.len / grid.width;
+    memcpy(job->pop, grid.pop, sizeof(grid.pop));
+    free_grid(&grid);
+}
+
+static Job *push_job(Batch *batch) {
+    if (batch->len == batch->cap) {
+        batch->cap  = batch->cap ? batch->cap * 2 : 64;
+        batch->jobs = realloc(batch->jobs, batch->cap * sizeof(Job));
+        if (!batch->jobs) {
+            fprintf(stderr, "batch: out of memory\n");
+            exit(1);
+        }
+    }
+    return &batch->jobs[batch->len++];
+}
+
+static bool is_snapshot(const char *arg) {
+    const size_t len = strlen(arg);
+    return len > 5 && strcmp(arg + len - 5, ".snap") == 0;
+}
+
+// adds the worlds of one line, false when it doesn't parse
+static bool parse_line(Batch *batch, const char *line) {
+    char what[256], seeds[64];
+    unsigned width = BATCH_W, height = BATCH_H, ticks;
+    const i32 got = sscanf(line, "%255s %63s %u %u %u", what, seeds, &ticks, &width, &height);
+    if (got < 3 || got == 4 || !width || !height || (u64)width * height > MAX_CELLS) return false;
+
+    Job job = { .ticks = ticks, .width = width, .height = height };
+    snprintf(job.path, sizeof(job.path), "%s", what);
+    if (!is_snapshot(what) && !(job.scene = find_scene(what))) {
+        fprintf(stderr, "batch: no scene named %s\n", what);
+        return false;
+    }
+
+    unsigned long long first, last;
+    if (strcmp(seeds, "-") == 0) {
+        if (job.scene) return false;
+        job.own_seed = true;
+        first = last = 0;
+    } else {
+        char *end;
+        first = last = strtoull(seeds, &end, 10);
+        if (*end == '-') last = strtoull(end + 1, &end, 10);
+        if (*end || last < first) return false;
+    }
+    for (unsigned long long seed = first; ; ++seed) {
+        job.seed = seed;
+        *push_job(batch) = job;
+        if (seed == last) break;
+    }
+    return true;
+}
+
+static bool read_jobs(Batch *batch, const char *path) {
+    FILE *file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "batch: cannot open %s\n", path);
+        return false;
+    }
+    char line[512];
+    u32 n = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        n++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        if (strspn(line, " \t\r\n") == strlen(line)) continue;
+        if (!parse_line(batch, line)) {
+            fprintf(stderr, "batch: %s:%u: expected <scene|world.snap> <seed|first-last|-> <ticks> [width height]\n", path, n);
+            ok = false;
+        }
+    }
+    if (file != stdin) fclose(file);
+    return ok;
+}
+
+// biggest first, a snapshot's size isn't known before it is loaded so they go first
+static u64 job_cost(const Job *job) {
+    return job->scene ? (u64)job->width * job->height * job->ticks : UINT64_MAX;
+}
+
+static Batch *sorting;
+
+static int by_cost(const void *a, const void *b) {
+    const u64 ca = job_cost(&sorting->jobs[*(const u32 *)a]);
+    const u64 cb = job_cost(&sorting->jobs[*(const u32 *)b]);
+    if (ca != cb) return ca > cb ? -1 : 1;
+    // the same cost keeps the order of the jobs
+    return *(const u32 *)a < *(const u32 *)b ? -1 : 1;
+}
+
+static u32 online_cores(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0) return (u32)n;
+#endif
+    return MAX_THREADS;
+}
+
+i32 main(const i32 argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: batch <jobs|-> [threads]\n");
+        return 1;
+    }
+    const u32 threads = argc > 2 && strtoul(argv[2], NULL, 10) ? (u32)strtoul(argv[2], NULL, 10) : online_cores();
+
+    Batch batch = { 0 };
+    if (!read_jobs(&batch, argv[1])) return 1;
+    if (!batch.len) {
+        fprintf(stderr, "batch: no worlds in %s\n", argv[1]);
+        return 1;
+    }
+    batch.order = malloc(batch.len * sizeof(u32));
+    for (u32 i = 0; i < batch.len; ++i) batch.order[i] = i;
+    sorting = &batch;
+    qsort(batch.order, batch.len, sizeof(u32), by_cost);
+
+    Pool *pool = new_pool(threads - 1);
+    const f64 start = now_sec();
+    pool_run(pool, run_job, &batch, batch.len, threads);
+    const f64 wall = now_sec() - start;
+    free_pool(pool);
+
+    printf("%-16s %10s %6s %-11s %8s %16s %10s", "world", "seed", "ticks", "cells", "KiB", "hash", "ms");
+    // gas isn't cells, it has no count
+    for (u32 m = 1; m < MATERIALS_LEN; ++m) {
+        if (MATERIALS[m].flags & GAS) continue;
+        char name[16];
+        snprintf(name, sizeof(name), "%s", MATERIALS[m].name);
+        for (char *c = name; *c; ++c) if (*c == ' ') *c = '_';
+        printf(" %9s", name);
+    }
+    printf("\n");
+
+    f64 busy = 0, cell_ticks = 0;
+    u32 failed = 0;
+    for (u32 i = 0; i < batch.len; ++i) {
+        const Job *job = &batch.jobs[i];
+        const char *name = strrchr(job->path, '/') ? strrchr(job->path, '/') + 1 : job->path;
+        if (!job->ok) {
+            printf("%-16s cannot %s %s\n", name, job->scene ? "allocate" : "load", job->path);
+            failed++;
+            continue;
+        }
+        printf("%-16s %10llu %6u %4u x %-4u %8.1f %016llx %10.2f", name, (unsigned long long)job->seed,
+            job->ticks, job->width, job->height, job->kib, (unsigned long long)job->hash, job->ms);
+        for (u32 m = 1; m < MATERIALS_LEN; ++m) {
+            if (!(MATERIALS[m].flags & GAS)) printf(" %9u", job->pop[m]);
+        }
+        printf("\n");
+        busy += job->ms / 1e3;
+        cell_ticks += (f64)job->width * job->height * job->ticks;
+    }
+    printf("%u worlds on %u threads in %.2f s, %.1f worlds/sec, %.1f M cell ticks/sec, %.2fx busy\n",
+        batch.len - failed, threads, wall, (f64)(batch.len - failed) / wall, cell_ticks / wall * 1e-6, busy / wall);
+
+    free(batch.order);
+    free(batch.jobs);
+    return failed ? 1 : 0;
+}
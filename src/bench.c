@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __EMSCRIPTEN__
+#include <emscripten/heap.h>
+#else
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#include "sim.h"
+#include "scenes.h"
+#include "snapshot.h"
+#include "simd.h"
+
+// Headless tick throughput benchmark
+//   usage: bench [ticks] [scene|all|world.snap] [cores]
+//   a snapshot is stepped at its own size with no input, instead of the scenes
+//   without cores every scene is run both serial and with MAX_THREADS
+
+// the pixels per bit the game can be set to, at the default 800x600 world
+static const i32 PPBS[] = { 10, 4, 2, 1 };
+
+static f64 now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+
+static f64 peak_rss_mib(void) {
+#ifdef __EMSCRIPTEN__
+    // wasm memory only ever grows, its size is the peak
+    return (f64)emscripten_get_heap_size() / (1024.0 * 1024.0);
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return (f64)ru.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+    return (f64)ru.ru_maxrss / 1024.0;            // KiB
+#endif
+#endif
+}
+
+static void run(const Scene *scene, const i32 ppb, const u32 cores, const u32 ticks) {
+    Grid grid = new_grid(800, 600, ppb);
+    grid.seed  = 1;
+    grid.cores = cores;
+    scene->init(&grid);
+
+    f64 elapsed = 0;
+    for (u32 t = 0; t < ticks; ++t) {
+        scene->tick(&grid, t);
+
+        const f64 start = now_sec();
+        update_gravity(&grid);
+        elapsed += now_sec() - start;
+    }
+
+    const f64 tps = (f64)ticks / elapsed;
+    const f64 ns_cell = elapsed * 1e9 / ((f64)ticks * (f64)grid.len);
+    printf("%-14s %4u x %-4u %5u %12.1f %10.3f %10.1f\n",
+        scene->name, grid.width, grid.len / grid.width, cores, tps, ns_cell, peak_rss_mib());
+    free_grid(&grid);
+}
+
+static void run_snapshot(const char *path, const u32 cores, const u32 ticks) {
+    Grid grid = new_grid(800, 600, 1);
+    const f64 load_start = now_sec();
+    if (!load_snapshot(&grid, path)) {
+        fprintf(stderr, "bench: cannot load %s\n", path);
+        free_grid(&grid);
+        exit(1);
+    }
+    const f64 load_ms = (now_sec() - load_start) * 1e3;
+    grid.cores = cores;
+
+    const f64 start = now_sec();
+    for (u32 t = 0; t < ticks; ++t) update_gravity(&grid);
+    const f64 elapsed = now_sec() - start;
+
+    const f64 tps = (f64)ticks / elapsed;
+    const f64 ns_cell = elapsed * 1e9 / ((f64)ticks * (f64)grid.len);
+    printf("%-14s %4u x %-4u %5u %12.1f %10.3f %10.1f   load %.2f ms\n",
+        strrchr(path, '/') ? strrchr(path, '/') + 1 : path, grid.width, grid.len / grid.width, cores, tps, ns_cell, peak_rss_mib(), load_ms);
+    free_grid(&grid);
+}
+
+// every run is stepped in a child of its own, so the peak RSS it prints is its own
+//   and not that of the biggest grid before it. wasm can't fork, there the heap
+//   only grows and a row shows the largest so far
+static void run_apart(const Scene *scene, const char *path, const i32 ppb, const u32 cores, const u32 ticks) {
+#ifndef __EMSCRIPTEN__
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        if (scene) run(scene, ppb, cores, ticks);
+        else run_snapshot(path, cores, ticks);
+        fflush(stdout);
+        _exit(0);
+    }
+    if (pid > 0) {
+        i32 status;
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status)) exit(1);
+        return;
+    }
+#endif
+    if (scene) run(scene, ppb, cores, ticks);
+    else run_snapshot(path, cores, ticks);
+}
+
+static bool is_snapshot(const char *arg) {
+    const size_t len = strlen(arg);
+    return len > 5 && strcmp(arg + len - 5, ".snap") == 0;
+}
+
+i32 main(const i32 argc, char **argv) {
+    const u32 ticks = argc > 1 ? (u32)strtoul(argv[1], NULL, 10) : 600;
+    const char *filter = argc > 2 && strcmp(argv[2], "all") != 0 ? argv[2] : NULL;
+    const u32 cores = argc > 3 ? (u32)strtoul(argv[3], NULL, 10) : 0;
+
+    printf("simd: %s\n", SIMD_NAME);
+    printf("%-14s %-11s %5s %12s %10s %10s\n", "scene", "cells", "cores", "ticks/sec", "ns/cell", "rss MiB");
+    if (filter && is_snapshot(filter)) {
+        if (cores) {
+            run_apart(NULL, filter, 1, cores, ticks);
+        } else {
+            run_apart(NULL, filter, 1, 1, ticks);
+            run_apart(NULL, filter, 1, MAX_THREADS, ticks);
+        }
+        return 0;
+    }
+    for (u32 s = 0; s < SCENES_LEN; ++s) {
+        if (filter && strcmp(filter, SCENES[s].name) != 0) continue;
+        for (u32 p = 0; p < sizeof(PPBS)/sizeof(i32); ++p) {
+            if (cores) {
+                run_apart(&SCENES[s], NULL, PPBS[p], cores, ticks);
+            } else {
+                run_apart(&SCENES[s], NULL, PPBS[p], 1, ticks);
+                run_apart(&SCENES[s], NULL, PPBS[p], MAX_THREADS, ticks);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <pthread.h>
+#include "blocks.h"
+#include "sim.h"
+
+// the rule that leaves a block as it is, every cell takes its own
+#define BLOCK_KEEP 0xe4
+
+// the cells of a block as they are indexed
+enum { BL, BR, TL, TR };
+
+#define CLASS_COLUMN(id, name, flags, ...) \
+    (flags) & STILL ? BLOCK_STILL : (flags) & LIQUID ? BLOCK_LIQUID : (flags) & SOLID ? BLOCK_SOLID : BLOCK_EMPTY,
+static const u8 BLOCK_CLASS[16] = {
+    MATERIAL_LIST(CLASS_COLUMN)
+};
+#undef CLASS_COLUMN
+
+static u8 BLOCK_RULES[1024];
+// set for the classes that some random bits would move, so a block that was
+//   left as it is by the dice still keeps its chunks awake
+static bool BLOCK_RESTLESS[256];
+static pthread_once_t rules_once = PTHREAD_ONCE_INIT;
+
+typedef struct Block {
+    u8 cls[4];
+    u8 from[4];
+    bool done[4];
+} Block;
+
+// a cell only ever moves once a pass
+static bool block_swap(Block *b, const u32 p, const u32 q) {
+    if (b->done[p] || b->done[q]) return false;
+    const u8 cls = b->cls[p], from = b->from[p];
+    b->cls[p]  = b->cls[q];
+    b->from[p] = b->from[q];
+    b->cls[q]  = cls;
+    b->from[q] = from;
+    b->done[p] = b->done[q] = true;
+    return true;
+}
+
+static u8 block_rule(const u32 index) {
+    Block b = {0};
+    for (u32 p = 0; p < 4; ++p) {
+        b.cls[p]  = index >> (p * 2) & 3;
+        b.from[p] = p;
+    }
+    const u32 side = index >> 8 & 1;    // which top cell goes first
+    const u32 flow = index >> 9 & 1;    // whether liquids spread this time
+
+    // falls straight through what's lighter
+    for (u32 c = 0; c < 2; ++c) {
+        const u8 t = b.cls[TL + c], d = b.cls[BL + c];
+        if (t != BLOCK_STILL && d != BLOCK_STILL && t > d) block_swap(&b, TL + c, BL + c);
+    }
+    // slides down to the other side, unless stone sits in the way
+    for (u32 n = 0; n < 2; ++n) {
+        const u32 c = n ^ side;
+        const u8 t = b.cls[TL + c], d = b.cls[BR - c];
+        if (t == BLOCK_STILL || d == BLOCK_STILL || b.cls[TR - c] == BLOCK_STILL) continue;
+        if (t > d) block_swap(&b, TL + c, BR - c);
+    }
+    // spreads along a row into the empty cell next to it
+    for (u32 r = 0; flow && r < 4; r += 2) {
+        const u8 l = b.cls[BL + r], k = b.cls[BR + r];
+        if ((l == BLOCK_LIQUID && k == BLOCK_EMPTY) || (l == BLOCK_EMPTY && k == BLOCK_LIQUID)) block_swap(&b, BL + r, BR + r);
+    }
+    return (u8)(b.from[BL] | b.from[BR] << 2 | b.from[TL] << 4 | b.from[TR] << 6);
+}
+
+static void build_rules(void) {
+    for (u32 i = 0; i < 1024; ++i) {
+        BLOCK_RULES[i] = block_rule(i);
+        if (BLOCK_RULES[i] != BLOCK_KEEP) BLOCK_RESTLESS[i & 255] = true;
+    }
+}
+
+typedef struct Bands {
+    const Grid *grid;
+    u32 len;    // number of bands
+    u32 pass;   // 0 => blocks start on even rows and columns, 1 => odd
+    u32 phase;  // 0 => even bands, 1 => odd bands
+    u32 visited[MAX_STRIPS];
+} Bands;
+
+static void update_band(void *arg, const u32 job) {
+    Bands *bands = arg;
+    const Grid *grid = bands->grid;
+    const u32 w = grid->width;
+    const u32 height = grid->len / w;
+    const u32 rows = grid->chunks.len / grid->chunks.width;
+    const u32 cw = grid->chunks.width;
+    const u32 o = bands->pass;
+    const u32 s = job * 2 + bands->phase;
+
+    // cut as the strips, a block starting on the last row of a band reaches
+    //   into the next one, which is idle
+    const u32 from = s * rows / bands->len * CHUNK_SIZE + o;
+    const u32 to   = (s + 1) * rows / bands->len * CHUNK_SIZE + o;
+    Rng rng = new_rng(grid->seed, (grid->tick * 2 + o) * MAX_STRIPS + s);
+    u32 bits = 0, left = 0;
+    u32 visited = 0;
+
+    for (u32 y = from; y < to && y + 1 < height; y += 2) {
+        const u8 *awake_lo = &grid->chunks.awake[(y / CHUNK_SIZE) * cw];
+        const u8 *awake_hi = &grid->chunks.awake[((y + 1) / CHUNK_SIZE) * cw];
+        u8 *lo = &grid->data[y * w];
+        u8 *hi = lo + w;
+        for (u32 x = o; x + 1 < w; x += 2) {
+            if (!awake_lo[x / CHUNK_SIZE] && !awake_hi[(x + 1) / CHUNK_SIZE]) continue;
+            visited += 4;
+            const u8 cells[4] = { lo[x], lo[x + 1], hi[x], hi[x + 1] };
+            if (!(cells[BL] | cells[BR] | cells[TL] | cells[TR])) continue;
+
+            // the dice are only rolled for blocks holding something, 2 bits each
+            if (!left) {
+                bits = rng_next(&rng);
+                left = 16;
+            }
+            const u32 cls = BLOCK_CLASS[cells[BL]] | BLOCK_CLASS[cells[BR]] << 2
+                | BLOCK_CLASS[cells[TL]] << 4 | BLOCK_CLASS[cells[TR]] << 6;
+            const u8 rule = BLOCK_RULES[cls | (bits & 3) << 8];
+            bits >>= 2;
+            left--;
+
+            const u32 at[4] = { y * w + x, y * w + x + 1, (y + 1) * w + x, (y + 1) * w + x + 1 };
+            if (rule == BLOCK_KEEP) {
+                if (BLOCK_RESTLESS[cls]) {
+                    wake_cell(grid, at[BL]);
+                    wake_cell(grid, at[TR]);
+                }
+                continue;
+            }
+            for (u32 p = 0; p < 4; ++p) {
+                const u32 src = rule >> (p * 2) & 3;
+                if (src == p) continue;
+                const u32 i = at[p];
+                grid->data[i] = cells[src];
+                grid->dir[i]  = 0;
+                grid->pow[i]  = 0;
+                grid->moved[i >> 6] |= (u64)1 << (i & 63);
+                wake_cell(grid, i);
+            }
+        }
+    }
+    bands->visited[s] = visited;
+}
+
+// The bands are stepped like the strips, the even ones in parallel then the odd
+//   ones, each with its own rng stream, so the result doesn't depend on the cores.
+//   Within a band the blocks don't touch, only wake_cell reaches past a block.
+void update_blocks(Grid *grid, const u32 len) {
+    pthread_once(&rules_once, build_rules);
+
+    Bands bands = { .grid = grid, .len = len };
+    for (bands.pass = 0; bands.pass < 2; ++bands.pass) {
+        for (bands.phase = 0; bands.phase < 2; ++bands.phase) {
+            const u32 jobs = (len - bands.phase + 1) / 2;
+            pool_run(grid->pool, update_band, &bands, jobs, grid->cores);
+        }
+    }
+    // those of the second pass, every cell of an awake chunk is in one of its blocks
+    for (u32 s = 0; s < len; ++s) grid->counts.visited += bands.visited[s];
+}
@@ -0,0 +1,35 @@
+#ifndef CAND_BLOCKS_H
+#define CAND_BLOCKS_H
+#include "types.h"
+
+// The second step engine (Grid.engine == ENGINE_BLOCKS). The grid is cut into
+// 2x2 blocks, every tick once on even and once on odd rows and columns (the
+// Margolus neighbourhood), and each block is rearranged by one lookup in
+// BLOCK_RULES by the classes of its four cells. Nothing outside a block is read
+// or written, so the blocks of a pass can be stepped in any order, on any thread
+/*
+    index = BL | BR << 2 | TL << 4 | TR << 6 | 2 random bits << 8
+            TL TR       a class per cell, the bottom row is the lower y
+            BL BR
+    rule  = where each of BL, BR, TL, TR takes its cell from, 2 bits each
+
+    heavier cells fall through lighter ones, then slide down the other side
+    of the block, then liquids spread along a row half the time
+*/
+// Only the classes are looked at, so what sinks through what is the class
+// order and not the material's density, wood sinks like sand
+
+typedef enum BlockClass {
+    BLOCK_EMPTY,    // and gas, which isn't cells
+    BLOCK_LIQUID,
+    BLOCK_SOLID,
+    BLOCK_STILL,
+} BlockClass;
+
+struct Grid;
+
+// steps every awake chunk of the grid once, the part of update_gravity that
+//   moves cells, in the same bands as its strips
+void update_blocks(struct Grid *grid, u32 bands);
+
+#endif //CAND_BLOCKS_H
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+#include "gas.h"
+
+// a block loses 1 / (1 << GAS_FADE) of its gas each tick, and 1 more
+#define GAS_FADE 7
+
+bool alloc_gas(Gas *gas, const u32 width, const u32 height) {
+    gas->w = (width  + GAS_SCALE - 1) >> GAS_SHIFT;
+    gas->h = (height + GAS_SCALE - 1) >> GAS_SHIFT;
+    const size_t len = (size_t)gas_stride(gas) * (gas->h + 2);
+    gas->d    = calloc(len, sizeof(u16));
+    gas->back = calloc(len, sizeof(u16));
+    gas->open = calloc(len, sizeof(u16));
+    gas->filled = calloc(gas->w, sizeof(u32));
+    gas->live = false;
+    return gas->d && gas->back && gas->open && gas->filled;
+}
+
+void free_gas(const Gas *gas) {
+    free(gas->filled);
+    free(gas->open);
+    free(gas->back);
+    free(gas->d);
+}
+
+void clear_gas(Gas *gas) {
+    memset(gas->d, 0, (size_t)gas_stride(gas) * (gas->h + 2) * sizeof(u16));
+    gas->live = false;
+}
+
+void add_gas(Gas *gas, const u32 x, const u32 y, const u16 amount) {
+    u16 *d = &gas->d[((y >> GAS_SHIFT) + 1) * gas_stride(gas) + (x >> GAS_SHIFT) + 1];
+    *d = *d + amount < GAS_MAX ? *d + amount : GAS_MAX;
+    gas->live = true;
+}
+
+// the top bit of every non zero byte of v, down to the bottom bit
+static inline u32 nonzero_bytes(const u32 v) {
+    return ((((v & 0x7f7f7f7fu) + 0x7f7f7f7fu) | v) & 0x80808080u) >> 7;
+}
+
+// adds the cells filled in lanes * 4 blocks of a row of cells to filled, a count
+//   per byte. Kept to whole vectors and out of line (inlined, the restricts are
+//   lost) so the compiler vectorizes it at -O2
+static __attribute__((noinline)) void count_filled(u32 *restrict filled, const u8 *restrict row, const size_t lanes) {
+    for (size_t bx = 0; bx < lanes * 4; ++bx) {
+        u32 v;
+        memcpy(&v, &row[bx * sizeof(u32)], sizeof(u32));
+        filled[bx] += nonzero_bytes(v);
+    }
+}
+
+// opens the blocks at most half filled with cells. A block is GAS_SCALE (4) cells
+//   wide, so a row of it is one u32 whose non zero bytes are counted in one go,
+//   the cells are read in order a row at a time
+static void open_blocks(Gas *gas, const u8 *data, const u32 width, const u32 height) {
+    _Static_assert(GAS_SCALE == sizeof(u32), "a row of a block is one u32");
+    const u32 stride = gas_stride(gas);
+    const u32 whole = width >> GAS_SHIFT;
+    u32 *filled = gas->filled;
+    for (u32 by = 0; by < gas->h; ++by) {
+        memset(filled, 0, gas->w * sizeof(u32));
+        for (u32 y = by << GAS_SHIFT; y < ((by + 1) << GAS_SHIFT) && y < height; ++y) {
+            const u8 *row = &data[y * width];
+            // a count per byte, summed up below
+            count_filled(filled, row, whole / 4);
+            for (u32 x = whole / 4 * 4 << GAS_SHIFT; x < width; ++x) {
+                filled[x >> GAS_SHIFT] += (u32)(row[x] != 0) << (x % GAS_SCALE * 8);
+            }
+        }
+        u16 *open = &gas->open[(by + 1) * stride + 1];
+        for (u32 bx = 0; bx < gas->w; ++bx) {
+            open[bx] = ((filled[bx] * 0x01010101u) >> 24) <= GAS_SCALE * GAS_SCALE / 2 ? 0xffff : 0;
+        }
+    }
+}
+
+// one row of the pass, every pointer is at the border block left of the row, the
+//   row is lanes * GAS_LANES blocks long. Returns the or of the new densities
+static u16 gas_row(u16 *restrict out, const u16 *restrict c, const u16 *restrict b, const u16 *restrict u,
+    const u16 *restrict oc, const u16 *restrict ob, const u16 *restrict ou, const size_t lanes) {
+    u16 any = 0;
+    for (size_t x = 1; x <= lanes * GAS_LANES; ++x) {
+        // closed blocks hold no gas, so only what c can't send them needs the masks
+        const u16 held = (u16)((c[x] & ~oc[x - 1]) + (c[x] & ~oc[x + 1]) +
+            (c[x] & ~ou[x]) * 3 + (c[x] & ~ob[x]));
+        const u16 sum = (u16)(c[x] * 2 + c[x - 1] + c[x + 1] + b[x] * 3 + u[x] + held);
+        u16 d = sum >> 3;
+        d = (u16)(d - (d >> GAS_FADE) - (d > 0));
+        d &= oc[x];
+        out[x] = d;
+        any |= d;
+    }
+    return any;
+}
+
+void update_gas(Gas *gas, const u8 *data, const u32 width, const u32 height) {
+    if (!gas->live) return;
+    open_blocks(gas, data, width, height);
+
+    const size_t stride = gas_stride(gas);
+    u16 any = 0;
+    for (size_t by = 1; by <= gas->h; ++by) {
+        const size_t i = by * stride;
+        any |= gas_row(&gas->back[i], &gas->d[i], &gas->d[i - stride], &gas->d[i + stride],
+            &gas->open[i], &gas->open[i - stride], &gas->open[i + stride], (stride - 2) / GAS_LANES);
+    }
+    u16 *d = gas->d;
+    gas->d    = gas->back;
+    gas->back = d;
+    gas->live = any != 0;
+}
@@ -0,0 +1,63 @@
+#ifndef CAND_GAS_H
+#define CAND_GAS_H
+#include <stdbool.h>
+#include "types.h"
+
+// Gas isn't cells. It is a density per block of GAS_SCALE x GAS_SCALE cells,
+// stepped by its own pass after the cells: every block keeps some of its gas,
+// spreads some sideways and sends most of it up, the same sum for every block
+// with no branches, so the compiler can vectorize it. Blocks mostly filled
+// with cells are closed, gas that would go into them stays where it was
+/*
+    new = (2c + l + r + 3b + u + what c couldn't send to closed neighbours) / 8
+          - a little, so it thins out and is gone
+
+          u          b is the block below, whose 3/8 up is the buoyancy
+        l c r
+          b
+*/
+
+#define GAS_SHIFT 2
+#define GAS_SCALE (1 << GAS_SHIFT)
+// densest a block gets, the sum of a block and its neighbours weighs them up
+//   to 14 times over and has to stay in a u16
+#define GAS_MAX   4095
+// what one painted cell adds to its block
+#define GAS_PUFF  (GAS_MAX / 8)
+// blocks the pass does at a time, rows are padded to a multiple of it with closed
+//   blocks so it has no tail and the compiler can vectorize it at -O2
+#define GAS_LANES 8
+
+typedef struct Gas {
+    u16 *d;     // density of the blocks, rows of gas_stride with a border of closed, empty blocks
+    u16 *back;
+    u16 *open;  // 0xffff where gas can go, 0 for the border and filled blocks
+    u32 *filled; // a row of cell counts, for working out open
+    u32 w, h;   // blocks, without the border
+    bool live;  // any gas left, the pass is skipped while there is none
+} Gas;
+
+// false when it doesn't fit in memory
+bool alloc_gas(Gas *gas, u32 width, u32 height);
+void free_gas(const Gas *gas);
+void clear_gas(Gas *gas);
+// adds amount to the block of cell x, y
+void add_gas(Gas *gas, u32 x, u32 y, u16 amount);
+// data is the grid's cells, width x height of them
+void update_gas(Gas *gas, const u8 *data, u32 width, u32 height);
+
+static inline u32 gas_stride(const Gas *gas) {
+    return (gas->w + GAS_LANES - 1) / GAS_LANES * GAS_LANES + 2;
+}
+
+// where block b of the field is in d, counting the blocks without the border
+static inline u32 gas_index(const Gas *gas, const u32 b) {
+    return (b / gas->w + 1) * gas_stride(gas) + b % gas->w + 1;
+}
+
+// the density at cell x, y
+static inline u16 gas_at(const u16 *d, const Gas *gas, const u32 x, const u32 y) {
+    return d[((y >> GAS_SHIFT) + 1) * gas_stride(gas) + (x >> GAS_SHIFT) + 1];
+}
+
+#endif //CAND_GAS_H
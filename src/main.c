@@ -3,109 +3,69 @@
 #include "raygui.h"
 #include "raymath.h"
 #include "types.h"
+#include "sim.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "profile.h"
+#include "world.h"
+#ifdef __EMSCRIPTEN__
+#include <emscripten/emscripten.h>
+#endif
 
 const i32 GRID_WIDTH  = 800;
 const i32 GRID_HEIGHT = 600;
 const i32 PPB = 10;
-const f32 TPS = 60.f;
-const u32 MAX_THREADS = 6;
-
-typedef struct Grid {
-    u32 *data;
-    i32 pbb;
-    f32 buff_pbb;
+const char *REC_PATH = "cand.rec";
+const char *SNAP_PATH = "cand.snap";
+const char *PROF_PATH = "cand_prof.csv";
+const char *CACHE_PATH = "cand_cache";
+const u32 MAX_FROZEN = 256;     // pages of a big world kept in memory, 16 KiB each so 4 MiB
+const f32 MAX_ZOOM = 8.f;
+const f32 PAN_SPEED = 600.f;    // screen pixels per second
+
+// cpu side copy of the grid as pixels, uploaded once a frame and drawn scaled by pbb
+typedef struct Canvas {
+    Color *pixels;
+    Texture2D tex;
     u32 width;
-    u32 len;
-    u32 tps;
-    u32 num;
-    struct {
-        u32 num;
-        bool on;
-        bool draw;
-    } dbg;
-    u32 selected_type;
-    struct {
-        u32 radius;
-        f32 buff;
-    } brush;
-    u32 cores;
-    Vector2 pos;
-    bool line;
-    bool tap;
-    bool man_step;
-    bool i_on_hov;
-} Grid;
-
-
-// TODO:
-/*
-typedef struct Px {
-    u32 properties 0b10000000000000000000000000000000
-    u8  direction  0b10000000  | NW N NE E SE S SW W |
-    u16 pow        0b1000000000000000  number of tick the px should move in the provided direction
-    *u8 of padding inserted by compiler, we can put extra data here if need be*
-} Px;
-use the pow and direction to determine where to push the px, or transfer pow to other pxs if blocks
-*/
-
-// Properties
-#define HOVERED 0b10000000000000000000000000000000
-#define UPDATED 0b01000000000000000000000000000000
-
-#define LIQUID  0b00100000000000000000000000000000 // flows
-#define SOLID   0b00010000000000000000000000000000 // stacks
-#define GAS     0b00001000000000000000000000000000 // tbd
-#define FLOAT   0b00000100000000000000000000000000 // float upon liquid
-#define STILL   0b00000010000000000000000000000000 // Do not move the block
-
-// Types
-#define SOLID_WHITE  (0b00000000000000000000000000000001 | SOLID)
-#define SOLID_RED    (0b00000000000000000000000000000010 | SOLID)
-#define LIQUID_BLUE  (0b00000000000000000000000000000100 | LIQUID)
-#define STILL_GREY   (0b00000000000000000000000000001000 | STILL)
-
-
-Grid new_grid(const i32 ppb) {
-    const i32 width = GRID_WIDTH / ppb;
-    const i32 height = GRID_HEIGHT / ppb;
-    const i32 len = width * height;
-
-    const Grid grid = {
-        .data = calloc(len, sizeof(i32)),
-        .pbb = ppb,
-        .buff_pbb = ppb,
-        .width = width,
-        .len = len,
-        .tps = TPS,
-        .selected_type = SOLID_WHITE,
-        .dbg = {
-            .on = false,
-            .draw = true
-        },
-        .cores = MAX_THREADS,
-    };
-    return grid;
-}
-
-void free_grid(const Grid *grid) {
-    free(grid->data);
-}
-
-void update_hovered_tile(Grid *grid);
-void draw_grid(const Grid *grid);
-void place_sand(Grid *grid);
-void update_gravity(const Grid *grid);
-void reset_data(Grid *grid);
+    u32 height;
+    i32 pbb;
+} Canvas;
+
+// everything that lives across frames
+typedef struct App {
+    Grid grid;
+    Canvas canvas;
+    Scheduler sched;
+    Profiler prof;
+    u64 last_tick;
+    World world;
+    Camera2D camera;
+} App;
+
+void frame(void *arg);
+void update_hovered_tile(Grid *grid, const Camera2D *camera);
+void update_camera(Camera2D *camera, const Grid *grid, const World *world);
+Vector2 window_pos(const Grid *grid, const World *world);
+bool follow_camera(Grid *grid, World *world, const Camera2D *camera);
+void reset_grid(Grid *grid, World *world);
+void switch_world(Grid *grid, World *world);
+void sync_canvas(Canvas *canvas, const Grid *grid);
+void free_canvas(const Canvas *canvas);
+Color cell_color(u8 cell);
+void draw_grid(const Grid *grid, const u8 *cells, const u16 *gas, Canvas *canvas);
+void draw_chunks(const Grid *grid);
+void draw_lines(const Grid *grid, Vector2 pos);
+void draw_brush(const Grid *grid);
+bool place_sand(Grid *grid);
 i32 inverse(i32 x, i32 min, i32 max);
 f32 inversef(f32 x, f32 min, f32 max);
 void update_tps(Grid *grid);
-void draw_extra_data(Grid *grid);
-void draw_side_panel(Grid *grid);
-void flop(u32 *lhs, u32 *rhs);
+void draw_extra_data(Grid *grid, const Scheduler *sched, const Profiler *prof, const World *world);
+void draw_side_panel(Grid *grid, Scheduler *sched, World *world);
 void print_bin(u32 num);
 void print_biln(u32 num);
-void update_real_num_dbg(Grid * grid);
-bool check_for_update(Grid *grid);
+u32 check_for_update(Grid *grid, Scheduler *sched);
 void *draw_grid_slice(void *d);
 
 i32 main(void) {
@@ -115,64 +75,142 @@ i32 main(void) {
     // SetTargetFPS(60);
     GuiSetStyle(DEFAULT, TEXT_SIZE, 20);
 
-    Grid grid = new_grid(PPB);
-
-    while (!WindowShouldClose()) {
-        if (IsKeyPressed(KEY_R)) reset_data(&grid);
-        if (IsKeyPressed(KEY_G)) grid.line = !grid.line;
+    static App app;
+    app.grid  = new_grid(GRID_WIDTH, GRID_HEIGHT, PPB);
+    app.sched = new_scheduler();
+    // the middle of the grid on screen, zoom 1 shows the grid as it always was
+    app.camera = (Camera2D){
+        .offset = { GRID_WIDTH / 2.f, GRID_HEIGHT / 2.f },
+        .target = { GRID_WIDTH / 2.f, GRID_HEIGHT / 2.f },
+        .zoom = 1.f,
+    };
 
-        update_tps(&grid);
-        update_hovered_tile(&grid);
+#ifdef __EMSCRIPTEN__
+    // the browser calls frame every animation frame, main never gets past this
+    emscripten_set_main_loop_arg(frame, &app, 0, true);
+#else
+    while (!WindowShouldClose()) frame(&app);
+#endif
+    free_scheduler(&app.sched);
+    free_canvas(&app.canvas);
+    stop_world(&app.world);
+    stop_recording(&app.grid);
+    free_grid(&app.grid);
+    CloseWindow();
+    return 0;
+}
 
-        place_sand(&grid);
-        if (check_for_update(&grid)) {
-            update_gravity(&grid);
-            if (grid.dbg.on) {
-                update_real_num_dbg(&grid);
-            }
+// input, stepping and drawing of one frame
+void frame(void *arg) {
+    App *app = arg;
+    Grid *grid = &app->grid;
+    Scheduler *sched = &app->sched;
+    Profiler *prof = &app->prof;
+    World *world = &app->world;
+    Camera2D *camera = &app->camera;
+    Canvas *canvas = &app->canvas;
+
+    lock_grid(sched);
+    if (world->want != world->on) {
+        switch_world(grid, world);
+        camera->zoom = 1.f;
+        camera->target = camera->offset;
+        if (world->on) {
+            const Vector2 pos = window_pos(grid, world);
+            camera->target = (Vector2){
+                pos.x + (f32)(grid->width * grid->pbb) / 2.f,
+                pos.y + (f32)(grid->len / grid->width * grid->pbb) / 2.f,
+            };
         }
+        sched->dirty = true;
+    }
+    if (IsKeyPressed(KEY_R)) {
+        reset_grid(grid, world);
+        sched->dirty = true;
+    }
+    // snapshots and logs are of a plain grid, the pages of a big world aren't in them
+    if (IsKeyPressed(KEY_F5) && !world->on && !save_snapshot(grid, SNAP_PATH)) {
+        TraceLog(LOG_WARNING, "cand: cannot save %s", SNAP_PATH);
+    }
+    if (IsKeyPressed(KEY_F9) && !world->on && load_snapshot(grid, SNAP_PATH)) sched->dirty = true;
+    if (IsKeyPressed(KEY_F3)) prof_dump_csv(prof, PROF_PATH);
+    if (IsKeyPressed(KEY_G)) grid->line = !grid->line;
+    if (IsKeyPressed(KEY_F2) && !world->on) {
+        // starting resets the grid, so the log can be replayed from empty
+        if (grid->rec) stop_recording(grid);
+        else start_recording(grid, REC_PATH);
+        sched->dirty = true;
+    }
 
-        BeginDrawing();
-        ClearBackground(BLACK);
+    PROF_SCOPE(prof, PROF_TPS) update_tps(grid);
+    update_camera(camera, grid, world);
+    if (follow_camera(grid, world, camera)) sched->dirty = true;
+    PROF_SCOPE(prof, PROF_HOVER) update_hovered_tile(grid, camera);
 
-        if (grid.dbg.draw) {
-            draw_grid(&grid);
+    PROF_SCOPE(prof, PROF_PLACE) if (place_sand(grid)) sched->dirty = true;
+    const u32 ticks = check_for_update(grid, sched);
+    if (sched->threaded) {
+        sched->pending += ticks;
+    } else {
+        PROF_SCOPE(prof, PROF_GRAVITY) for (u32 i = 0; i < ticks; ++i) update_gravity(grid);
+    }
+    unlock_grid(sched);
+
+    BeginDrawing();
+    ClearBackground(BLACK);
+
+    // the grid only ever covers its corner of the window, the side panel is past it
+    BeginScissorMode(0, 0, GRID_WIDTH, GRID_HEIGHT);
+    BeginMode2D(*camera);
+    if (grid->dbg.draw) {
+        if (sched->threaded) {
+            u32 len, width;
+            const u16 *gas;
+            const u8 *cells = acquire_frame(sched, &len, &width, &gas);
+            PROF_SCOPE(prof, PROF_DRAW_GRID) if (len == grid->len) draw_grid(grid, cells, gas, canvas);
+            release_frame(sched);
         } else {
-            for (u32 i = 0; i<grid.len; ++i) grid.data[i] &= ~UPDATED;
+            PROF_SCOPE(prof, PROF_DRAW_GRID) draw_grid(grid, grid->data, grid->gas.d, canvas);
         }
-        draw_side_panel(&grid);
-        draw_extra_data(&grid);
-
-        EndDrawing();
     }
-    free_grid(&grid);
-    CloseWindow();
-    return 0;
-}
 
-bool check_for_update(Grid *grid) {
-    static f32 c = 0;
+    lock_grid(sched);
+    if (grid->dbg.on) draw_chunks(grid);
+    EndMode2D();
+    EndScissorMode();
+    PROF_SCOPE(prof, PROF_SIDE_PANEL) draw_side_panel(grid, sched, world);
+    draw_extra_data(grid, sched, prof, world);
+
+    // the sim thread times its own ticks, a reset starts grid->tick over
+    prof_add(prof, PROF_GRAVITY, (u64)(sched->step_sec * 1e9));
+    sched->step_sec = 0;
+    prof_frame(prof, (u32)(grid->tick >= app->last_tick ? grid->tick - app->last_tick : grid->tick), grid->counts);
+    app->last_tick = grid->tick;
+    grid->counts = (StepCounts){0};
+    unlock_grid(sched);
+
+    EndDrawing();
+
+    if (sched->want_thread && !sched->threaded) start_sim_thread(sched, grid);
+    if (!sched->want_thread && sched->threaded) stop_sim_thread(sched);
+}
 
+// how many ticks to step this frame
+u32 check_for_update(Grid *grid, Scheduler *sched) {
     if (!grid->man_step) {
-        c += GetFrameTime();
+        if (sched->threaded) return 0; // the sim thread keeps its own time
+        return due_ticks(sched, GetFrameTime(), grid->tps);
+    }
 
-        // TODO: only account for tps 0 <= FPS
-        //   change update gravity multiple times a tick, according to FPS & TPS
-        if (c <= 1.f / (f32)grid->tps) {
-            return false;
-        }
-        c = 0;
+    if (grid->tap) {
+        if (!IsKeyPressed(KEY_N)) return 0;
     } else {
-        if (grid->tap) {
-            if (!IsKeyPressed(KEY_N)) return false;
-        } else {
-            if (!IsKeyDown(KEY_N)) return false;
-        }
+        if (!IsKeyDown(KEY_N)) return 0;
     }
-    return true;
+    return 1;
 }
 
-void draw_extra_data(Grid *grid) {
+void draw_extra_data(Grid *grid, const Scheduler *sched, const Profiler *prof, const World *world) {
     const f32 PADDING = 10;
     const f32 CHAR_WIDTH = 12.f;
     const f32 x = (f32)GRID_WIDTH - PADDING;
@@ -187,6 +225,14 @@ void draw_extra_data(Grid *grid) {
         TEXT_ALIGN_RIGHT, WHITE);
     y += (h + PADDING) / 2;
 
+    if (grid->rec) {
+        const char *rec_text = TextFormat("REC %s", REC_PATH);
+        w = (f32)TextLength(rec_text) * CHAR_WIDTH;
+        GuiDrawText(rec_text, (Rectangle){ x - (f32)TextLength(rec_text) * CHAR_WIDTH,  y, w, h },
+            TEXT_ALIGN_RIGHT, RED);
+        y += (h + PADDING) / 2;
+    }
+
     const char *num_text = TextFormat("Num: %d", grid->num);
     w = (f32)TextLength(num_text) * CHAR_WIDTH;
     GuiDrawText(num_text, (Rectangle){ x - (f32)TextLength(num_text) * CHAR_WIDTH,  y, w, h },
@@ -194,10 +240,64 @@ void draw_extra_data(Grid *grid) {
     y += (h + PADDING) / 2;
 
     if (grid->dbg.on) {
-        const char *real_num_dbg_text = TextFormat("Real Num: %d", grid->dbg.num);
-        w = (f32)TextLength(real_num_dbg_text) * CHAR_WIDTH;
-        GuiDrawText(real_num_dbg_text, (Rectangle){ x - (f32)TextLength(real_num_dbg_text) * CHAR_WIDTH,  y, w, h },
+        for (u8 t = EMPTY + 1; t < MATERIALS_LEN; ++t) {
+            if (flags_of(t) & GAS) continue; // not cells
+            const char *pop_text = TextFormat("%s: %d", MATERIALS[t].name, grid->pop[t]);
+            w = (f32)TextLength(pop_text) * CHAR_WIDTH;
+            GuiDrawText(pop_text, (Rectangle){ x - (f32)TextLength(pop_text) * CHAR_WIDTH,  y, w, h },
+                TEXT_ALIGN_RIGHT, WHITE);
+            y += (h + PADDING) / 2;
+        }
+
+        const char *real_tps_text = TextFormat("Real TPS: %d", sched->rate);
+        w = (f32)TextLength(real_tps_text) * CHAR_WIDTH;
+        GuiDrawText(real_tps_text, (Rectangle){ x - (f32)TextLength(real_tps_text) * CHAR_WIDTH,  y, w, h },
             TEXT_ALIGN_RIGHT, WHITE);
+        y += (h + PADDING) / 2;
+
+        u32 awake = 0;
+        for (u32 c = 0; c < grid->chunks.len; ++c) awake += grid->chunks.awake[c];
+        const char *awake_text = TextFormat("Awake: %d/%d", awake, grid->chunks.len);
+        w = (f32)TextLength(awake_text) * CHAR_WIDTH;
+        GuiDrawText(awake_text, (Rectangle){ x - (f32)TextLength(awake_text) * CHAR_WIDTH,  y, w, h },
+            TEXT_ALIGN_RIGHT, WHITE);
+        y += (h + PADDING) / 2;
+
+        if (world->on) {
+            const char *pages_text = TextFormat("Pages: %d frozen %d spilled", world->frozen, world->spilled);
+            w = (f32)TextLength(pages_text) * CHAR_WIDTH;
+            GuiDrawText(pages_text, (Rectangle){ x - (f32)TextLength(pages_text) * CHAR_WIDTH,  y, w, h },
+                TEXT_ALIGN_RIGHT, WHITE);
+            y += (h + PADDING) / 2;
+        }
+
+        // over the last PROF_FRAMES frames, F3 writes them all to PROF_PATH
+        const char *prof_text = TextFormat("ms min/avg/p99 (F3 %s)", PROF_PATH);
+        w = (f32)TextLength(prof_text) * CHAR_WIDTH;
+        GuiDrawText(prof_text, (Rectangle){ x - (f32)TextLength(prof_text) * CHAR_WIDTH,  y, w, h },
+            TEXT_ALIGN_RIGHT, GRAY);
+        y += (h + PADDING) / 2;
+
+        for (u32 p = 0; p < PROF_PHASES; ++p) {
+            const ProfStats stats = prof_stats(prof, p);
+            const char *phase_text = TextFormat("%s: %.2f/%.2f/%.2f", PROF_NAMES[p], stats.min, stats.avg, stats.p99);
+            w = (f32)TextLength(phase_text) * CHAR_WIDTH;
+            GuiDrawText(phase_text, (Rectangle){ x - (f32)TextLength(phase_text) * CHAR_WIDTH,  y, w, h },
+                TEXT_ALIGN_RIGHT, WHITE);
+            y += (h + PADDING) / 2;
+        }
+
+        // per frame
+        const StepCounts counts = prof_counts(prof);
+        const char *count_names[] = { "Visited", "Moved", "Displaced", "Blocked" };
+        const u32 count_values[]  = { counts.visited, counts.moved, counts.displaced, counts.blocked };
+        for (u32 c = 0; c < sizeof(count_values)/sizeof(u32); ++c) {
+            const char *count_text = TextFormat("%s: %d", count_names[c], count_values[c]);
+            w = (f32)TextLength(count_text) * CHAR_WIDTH;
+            GuiDrawText(count_text, (Rectangle){ x - (f32)TextLength(count_text) * CHAR_WIDTH,  y, w, h },
+                TEXT_ALIGN_RIGHT, WHITE);
+            y += (h + PADDING) / 2;
+        }
     }
 
     if (grid->dbg.on) {
@@ -205,7 +305,7 @@ void draw_extra_data(Grid *grid) {
     }
 }
 
-void draw_side_panel(Grid *grid) {
+void draw_side_panel(Grid *grid, Scheduler *sched, World *world) {
     const f32 PADDING = 10.f;
 
     const Vector2 pos = GetMousePosition();
@@ -220,7 +320,8 @@ void draw_side_panel(Grid *grid) {
     y += h + PADDING;
 
     if (GuiButton((Rectangle){ x,  y, w, h }, "Reset")) {
-        reset_data(grid);
+        reset_grid(grid, world);
+        sched->dirty = true;
     }
     y += h + PADDING;
 
@@ -237,13 +338,12 @@ void draw_side_panel(Grid *grid) {
         &grid->buff_pbb, 1, 100);
     y += h + PADDING;
 
-    const Color colors[] = { WHITE,        RED,       BLUE,        DARKGRAY }; // TODO: covert to i32 map?
-    const i32 ccs[]      = { SOLID_WHITE,  SOLID_RED, LIQUID_BLUE, STILL_GREY };
-    for (u32 i = 0; i < sizeof(colors)/sizeof(Color); ++i) {
-        const Rectangle bb = (Rectangle){ x + (float)i*(h + PADDING),  y, h, h };
-        GuiDrawRectangle(bb,4, ColorBrightness(colors[i], -0.2f), colors[i]);
+    for (u8 m = EMPTY + 1; m < MATERIALS_LEN; ++m) {
+        const Rectangle bb = (Rectangle){ x + (float)(m - 1)*(h + PADDING),  y, h, h };
+        const Color color = cell_color(m);
+        GuiDrawRectangle(bb,4, ColorBrightness(color, -0.2f), color);
         if (CheckCollisionPointRec(pos, bb) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
-            grid->selected_type = ccs[i];
+            grid->selected_type = m;
     }
     y += h + PADDING;
 
@@ -251,16 +351,23 @@ void draw_side_panel(Grid *grid) {
         "Toggle Tapping", &grid->tap);
     y += h + PADDING;
 
-    GuiToggle((Rectangle){ x,  y, w, h },
-        "Toggle Man Stepping", &grid->man_step);
+    GuiToggle((Rectangle){ x,  y, w / 2 - PADDING / 2, h },
+        "Man Stepping", &grid->man_step);
+    GuiToggle((Rectangle){ x + w / 2 + PADDING / 2,  y, w / 2 - PADDING / 2, h },
+        "Sim Thread", &sched->want_thread);
     y += h + PADDING;
 
     GuiToggle((Rectangle){ x,  y, w, h },
         "Toggle Index On Hover", &grid->i_on_hov);
     y += h + PADDING;
 
+    GuiToggle((Rectangle){ x,  y, w, h },
+        "Big World (wheel, right drag)", &world->want);
+    y += h + PADDING;
+
     const char *brush_size_text = TextFormat("Brush Size: %.0fpx", grid->brush.buff);
-    GuiDrawText(brush_size_text, (Rectangle){ x,  y, w, h }, TEXT_ALIGN_LEFT, WHITE);
+    GuiDrawText(brush_size_text, (Rectangle){ x,  y, w / 2, h }, TEXT_ALIGN_LEFT, WHITE);
+    GuiToggleGroup((Rectangle){ x + w / 2,  y, w / 4, h }, "Square;Circle", &grid->brush.shape);
     y += h + PADDING;
     if (GuiSlider((Rectangle){ x,  y, w, h }, 0, 0,
         &grid->brush.buff, 1, 100)) {
@@ -268,6 +375,18 @@ void draw_side_panel(Grid *grid) {
     }
     y += h + PADDING;
 
+    const char *cores_text = TextFormat("Cores: %d", grid->cores);
+    GuiDrawText(cores_text, (Rectangle){ x,  y, w / 2, h }, TEXT_ALIGN_LEFT, WHITE);
+    if (GuiSlider((Rectangle){ x + w / 2,  y, w / 2, h }, 0, 0,
+        &grid->buff_cores, 1, MAX_THREADS)) {
+        grid->cores = (u32)roundf(grid->buff_cores);
+    }
+    y += h + PADDING;
+
+    GuiDrawText("Engine", (Rectangle){ x,  y, w / 2, h }, TEXT_ALIGN_LEFT, WHITE);
+    GuiToggleGroup((Rectangle){ x + w / 2,  y, w / 4, h }, "Gravity;Blocks", &grid->engine);
+    y += h + PADDING;
+
     GuiToggle((Rectangle){ x,  y, w, h },
         "Toggle dbg", &grid->dbg.on);
     y += h + PADDING;
@@ -276,8 +395,10 @@ void draw_side_panel(Grid *grid) {
         "Toggle Drawing", &grid->dbg.draw);
 }
 
-i32 get_hovered_index(const Grid *grid) {
+i32 get_hovered_index(const Grid *grid, const Camera2D *camera) {
     Vector2 pos = GetMousePosition();
+    if (pos.x >= GRID_WIDTH || pos.y >= GRID_HEIGHT) return -1;
+    pos = Vector2Subtract(GetScreenToWorld2D(pos, *camera), (Vector2){ grid->pos.x, grid->pos.y });
     const f32 height = (f32)grid->len / (f32)grid->width * grid->pbb;
     const f32 width  = grid->width * grid->pbb;
     pos = (Vector2){
@@ -291,26 +412,81 @@ i32 get_hovered_index(const Grid *grid) {
     return xy.x + (xy.y * grid->width);
 }
 
-void update_hovered_tile(Grid *grid) {
-    u32 num = 0;
+void update_hovered_tile(Grid *grid, const Camera2D *camera) {
+    grid->brush.hovered = get_hovered_index(grid, camera);
+}
+
+// the wheel zooms in on the mouse, dragging with the right button or the arrows
+//   pan, the view is kept on the grid, or on the world when it is big
+void update_camera(Camera2D *camera, const Grid *grid, const World *world) {
+    const Vector2 mouse = GetMousePosition();
+    const bool over = mouse.x < GRID_WIDTH && mouse.y < GRID_HEIGHT;
+    const f32 wheel = GetMouseWheelMove();
+    if (over && wheel != 0) {
+        const Vector2 before = GetScreenToWorld2D(mouse, *camera);
+        camera->zoom = Clamp(camera->zoom * (1.f + wheel * 0.1f), 1.f, MAX_ZOOM);
+        const Vector2 after = GetScreenToWorld2D(mouse, *camera);
+        camera->target = Vector2Add(camera->target, Vector2Subtract(before, after));
+    }
+    if (over && IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+        camera->target = Vector2Subtract(camera->target, Vector2Scale(GetMouseDelta(), 1.f / camera->zoom));
+    }
+    const f32 speed = PAN_SPEED * GetFrameTime() / camera->zoom;
+    if (IsKeyDown(KEY_LEFT))  camera->target.x -= speed;
+    if (IsKeyDown(KEY_RIGHT)) camera->target.x += speed;
+    if (IsKeyDown(KEY_UP))    camera->target.y -= speed;
+    if (IsKeyDown(KEY_DOWN))  camera->target.y += speed;
+
+    const f32 width  = (f32)(world->on ? world_width(world)  : grid->width) * grid->pbb;
+    const f32 height = (f32)(world->on ? world_height(world) : grid->len / grid->width) * grid->pbb;
+    const f32 hw = GRID_WIDTH  / 2.f / camera->zoom;
+    const f32 hh = GRID_HEIGHT / 2.f / camera->zoom;
+    camera->target.x = Clamp(camera->target.x, hw, width  - hw > hw ? width  - hw : hw);
+    camera->target.y = Clamp(camera->target.y, hh, height - hh > hh ? height - hh : hh);
+}
 
-    const i32 hovered = get_hovered_index(grid);
-    const u32 r = grid->brush.radius - 1;
+// where the window of a big world is drawn, the world is drawn mirrored like
+//   the grid, world cell 0, 0 at the bottom right
+Vector2 window_pos(const Grid *grid, const World *world) {
+    return (Vector2){
+        .x = (f32)((world_width(world)  - (world->ox + world->win_w) * PAGE_SIZE) * grid->pbb),
+        .y = (f32)((world_height(world) - (world->oy + world->win_h) * PAGE_SIZE) * grid->pbb),
+    };
+}
 
-    const Vector2 xy = (Vector2){ hovered % grid->width, hovered / grid->width };
+// moves the window of a big world under the camera, and the grid with it
+bool follow_camera(Grid *grid, World *world, const Camera2D *camera) {
+    if (!world->on) return false;
+    const i32 x = (i32)world_width(world)  - 1 - (i32)(camera->target.x / grid->pbb);
+    const i32 y = (i32)world_height(world) - 1 - (i32)(camera->target.y / grid->pbb);
+    const bool moved = world_follow(world, x, y);
+    const Vector2 pos = window_pos(grid, world);
+    grid->pos.x = pos.x;
+    grid->pos.y = pos.y;
+    return moved;
+}
 
-    for (u32 i = 0; i < grid->len; ++i) {
-        // if (num = r*r) return;
-        const Vector2 ixy = (Vector2){ i % grid->width, i / grid->width };
-        if ((ixy.x < xy.x - r || ixy.y < xy.y - r) ||
-            (ixy.x > xy.x + r || ixy.y > xy.y + r)) {
-            grid->data[i] &= ~HOVERED;
-            num++;
-            continue;
-        }
+void reset_grid(Grid *grid, World *world) {
+    if (!world->on) {
+        reset_data(grid);
+        return;
+    }
+    // a new world, every page of the old one goes
+    stop_world(world);
+    switch_world(grid, world);
+}
 
-        grid->data[i] |= HOVERED;
+// starts or stops a big world to match world->want, the plain grid comes back empty
+void switch_world(Grid *grid, World *world) {
+    if (world->want && !world->on) {
+        world->want = start_world(world, grid, GRID_WIDTH, GRID_HEIGHT, MAX_FROZEN, CACHE_PATH);
     }
+    if (!world->want && world->on) stop_world(world);
+    if (world->on) return;
+    grid->px_width  = GRID_WIDTH;
+    grid->px_height = GRID_HEIGHT;
+    grid->pos.x = grid->pos.y = 0;
+    reset_data(grid);
 }
 
 void update_tps(Grid * grid) {
@@ -327,152 +503,148 @@ inline f32 inversef(const f32 x, const f32 min, const f32 max) {
     return max-(x-min);
 }
 
-void draw_grid(const Grid *grid) {
-    const u32 pbb = grid->pbb;
-    for (u32 i = 0; i < grid->len; ++i) {
-        const i32 x = inverse(i % grid->width, 0, (i32)grid->width - 1)                * pbb;
-        const i32 y = inverse(i / grid->width, 0, (i32)(grid->len / grid->width - 1))  * pbb;
-        const u32 unhovered = grid->data[i] & ~HOVERED & ~UPDATED;
-
-
-        if (unhovered) {
-            Color c = PURPLE;
-            if (unhovered == SOLID_WHITE)  c = RAYWHITE;
-            if (unhovered == SOLID_RED)    c = RED;
-            if (unhovered == LIQUID_BLUE)  c = BLUE;
-            if (unhovered == STILL_GREY)   c = DARKGRAY;
-            if (pbb <= 1) {
-                DrawPixel(x, y, c);
-            } else {
-                DrawRectanglePro((Rectangle){(f32)x, (f32)y, (f32)pbb, (f32)pbb},
-                    Vector2Zero(), 0.f, c);
-            }
-        }
+// EMPTY is BLANK
+Color cell_color(const u8 cell) {
+    if (cell >= MATERIALS_LEN) return PURPLE;
+    const Material *m = &MATERIALS[cell];
+    return (Color){ m->color.r, m->color.g, m->color.b, m->color.a };
+}
 
-        // TODO: find a more efficient way of drawing the grid
-        if (grid->line && pbb > 3) {
-            Color c = GRAY;
-            if (grid->data[i] & HOVERED) c = ColorBrightness(c, 0.8f);
-            DrawRectangleLines(x, y, pbb, pbb, c);
-        } else {
-            if (grid->data[i] & HOVERED) {
-                DrawRectangleLines(x, y, pbb, pbb, GRAY);
-            }
-        }
+// (re)makes the textures when the grid changed size
+void sync_canvas(Canvas *canvas, const Grid *grid) {
+    const u32 height = grid->len / grid->width;
+    if (canvas->pixels && canvas->width == grid->width && canvas->height == height
+        && canvas->pbb == grid->pbb) return;
+
+    free_canvas(canvas);
+    canvas->width  = grid->width;
+    canvas->height = height;
+    canvas->pbb    = grid->pbb;
+    canvas->pixels = calloc(grid->len, sizeof(Color));
+    canvas->tex = LoadTextureFromImage((Image){
+        .data = canvas->pixels,
+        .width = canvas->width,
+        .height = canvas->height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    });
+}
 
-        if (grid->i_on_hov && grid->data[i] & HOVERED) {
-            const char *text = TextFormat("%d", i);
-            DrawText(text, x, y, 20, LIGHTGRAY);
-        }
+void free_canvas(const Canvas *canvas) {
+    if (!canvas->pixels) return;
+    UnloadTexture(canvas->tex);
+    free(canvas->pixels);
+}
 
-        grid->data[i] &= ~UPDATED;
+// cells and gas are grid->data and grid->gas.d, or the frame published by the sim thread
+void draw_grid(const Grid *grid, const u8 *cells, const u16 *gas, Canvas *canvas) {
+    sync_canvas(canvas, grid);
+
+    const i32 pbb = grid->pbb;
+    const i32 height = grid->len / grid->width;
+
+    // the grid is drawn mirrored on both axes, so cell i is pixel len - 1 - i,
+    //   empty cells show the gas over them
+    const Color smoke = cell_color(GAS_WHITE);
+    Color *px = &canvas->pixels[grid->len - 1];
+    for (u32 y = 0, i = 0; y < (u32)height; ++y) {
+        for (u32 x = 0; x < grid->width; ++x, ++i, --px) {
+            const u16 d = cells[i] ? 0 : gas_at(gas, &grid->gas, x, y);
+            *px = d ? (Color){ smoke.r, smoke.g, smoke.b, (u8)(d * 255 / GAS_MAX) } : cell_color(cells[i]);
+        }
     }
+    UpdateTexture(canvas->tex, canvas->pixels);
+
+    const Vector2 pos = { grid->pos.x, grid->pos.y };
+    DrawTextureEx(canvas->tex, pos, 0.f, (f32)pbb, WHITE);
+    if (grid->line && pbb > 3) draw_lines(grid, pos);
+
+    draw_brush(grid);
 
-    DrawRectangleLines(grid->pos.x, grid->pos.y, grid->width * pbb, grid->len / grid->width * pbb, GRAY);
+    DrawRectangleLines(grid->pos.x, grid->pos.y, grid->width * pbb, height * pbb, GRAY);
 }
 
-void place_sand(Grid *grid) {
-    if (grid->tap) {
-        if (!IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) return;
-    } else {
-        if (!IsMouseButtonDown(MOUSE_LEFT_BUTTON)) return;
+// same as a DrawRectangleLines per cell, but a pair of one pixel strips per column
+//   and row, so it costs nothing to set up however big the grid gets
+void draw_lines(const Grid *grid, const Vector2 pos) {
+    const i32 pbb = grid->pbb;
+    const i32 w = (i32)grid->width * pbb;
+    const i32 h = (i32)(grid->len / grid->width) * pbb;
+    for (i32 x = 0; x < w; x += pbb) {
+        DrawRectangle((i32)pos.x + x, (i32)pos.y, 1, h, GRAY);
+        DrawRectangle((i32)pos.x + x + pbb - 1, (i32)pos.y, 1, h, GRAY);
+    }
+    for (i32 y = 0; y < h; y += pbb) {
+        DrawRectangle((i32)pos.x, (i32)pos.y + y, w, 1, GRAY);
+        DrawRectangle((i32)pos.x, (i32)pos.y + y + pbb - 1, w, 1, GRAY);
     }
+}
 
-    // TODO: would it worth it to make a get_hovered()?
-    //   This would use get_hovered_index() and use math with grid->brush.size
-    //   to return an array of the indexes of all hovered pxs.
-    for (u32 i = 0, c = 0; i < grid->len; ++i) {
-        if (!(grid->data[i] & HOVERED) || grid->data[i] & ~HOVERED) continue;
+// outlines the cells the brush would paint
+void draw_brush(const Grid *grid) {
+    const i32 hovered = grid->brush.hovered;
+    if (hovered < 0) return;
+
+    const i32 pbb = grid->pbb;
+    const i32 height = grid->len / grid->width;
+    const i32 r  = grid->brush.radius ? (i32)grid->brush.radius - 1 : 0;
+    const i32 cx = hovered % grid->width;
+    const i32 cy = hovered / grid->width;
+    const Color c = grid->line && pbb > 3 ? ColorBrightness(GRAY, 0.8f) : GRAY;
+
+    // mirrored like the grid, the top left of the brush is its far corner
+    const i32 sx = (i32)grid->pos.x + inverse(cx, 0, (i32)grid->width - 1) * pbb;
+    const i32 sy = (i32)grid->pos.y + inverse(cy, 0, height - 1) * pbb;
+    if (grid->brush.shape == BRUSH_CIRCLE) {
+        DrawCircleLines(sx + pbb / 2, sy + pbb / 2, ((f32)r + 0.5f) * (f32)pbb, c);
+    } else {
+        DrawRectangleLines(sx - r * pbb, sy - r * pbb, (r * 2 + 1) * pbb, (r * 2 + 1) * pbb, c);
+    }
 
-        grid->data[i] |= grid->selected_type;
-        grid->num++;
-        c++;
+    if (!grid->i_on_hov) return;
+    for (i32 y = cy - r; y <= cy + r; ++y) {
+        for (i32 x = cx - r; x <= cx + r; ++x) {
+            if (x < 0 || y < 0 || x >= (i32)grid->width || y >= height) continue;
+            if (!in_brush(grid, x - cx, y - cy)) continue;
+            const char *text = TextFormat("%d", x + y * grid->width);
+            DrawText(text, (i32)grid->pos.x + inverse(x, 0, (i32)grid->width - 1) * pbb,
+                (i32)grid->pos.y + inverse(y, 0, height - 1) * pbb, 20, LIGHTGRAY);
+        }
     }
 }
 
-inline void flop(u32 *lhs, u32 *rhs) {
-    const u32 tmp = *lhs;
-    *lhs = *rhs;
-    *rhs = tmp;
+// outlines the chunks stepped last tick
+void draw_chunks(const Grid *grid) {
+    const i32 pbb = grid->pbb;
+    const i32 height = grid->len / grid->width;
+    for (u32 c = 0; c < grid->chunks.len; ++c) {
+        if (!grid->chunks.awake[c]) continue;
+        const i32 x0 = (c % grid->chunks.width) * CHUNK_SIZE;
+        const i32 y0 = (c / grid->chunks.width) * CHUNK_SIZE;
+        const i32 x1 = x0 + CHUNK_SIZE < (i32)grid->width ? x0 + CHUNK_SIZE : (i32)grid->width;
+        const i32 y1 = y0 + CHUNK_SIZE < height ? y0 + CHUNK_SIZE : height;
+
+        // the grid is drawn mirrored, so the far corner of the chunk is its top left
+        const i32 x = (i32)grid->pos.x + inverse(x1 - 1, 0, (i32)grid->width - 1) * pbb;
+        const i32 y = (i32)grid->pos.y + inverse(y1 - 1, 0, height - 1) * pbb;
+        DrawRectangleLines(x, y, (x1 - x0) * pbb, (y1 - y0) * pbb, GREEN);
+    }
 }
 
-// for the given liquid block (index), displace it to the closest empty px
-/*
-    Key:
-        0 => empty
-        1 => sand
-        W => liquid
-        S => target liquid (start)
-        F => displaces to  (finish)
-
-    0 0 0 0 1 1 1 1 0 0 0
-
-    0 0 0 0 0 1 1 1 0 0 0
-
-    0 F 0 0 0 F 1 1 F 0 0
-      |       |     |
-    W W W W W W-S 1 W W W
-      |         |   |
-    W W 1 W W W S S-W W W
-      |
-    W W-S W W W W W W W W
-*/
-// treat the liquid like air, except you call this fn right before moving the block
-//   as to move it into air, and not replace the liquid
-i32 displace_liquid(const Grid *grid, const u32 index, const u32 max_iter) {
-    u32 mov = index;
-    i32 dir = grid->width;
-    for (u32 i = 0; i <= max_iter; ++i) {
-        if (i >= max_iter - 1) return -1;
-        if (mov + dir < 0) mov = grid->width - 1;
-        if (mov + dir > grid->len) mov = grid->len - grid->width + 1;
-
-        const u32 unhover = grid->data[mov] & ~HOVERED; // 0b01000001
-
-        if (!unhover) break;
-
-        u32 before = 0;
-        if (mov <= 0)
-            before = grid->data[grid->width - 1] & ~HOVERED;
-        else
-            before = grid->data[mov - 1] & ~HOVERED;
-
-        u32 after = 0;
-        if (mov >= grid->len)
-            after = grid->data[grid->len - grid->width + 1] & ~HOVERED;
-        else
-            after = grid->data[mov + 1] & ~HOVERED;
-
-        u32 above = grid->data[mov] & ~HOVERED;
-        if (mov / grid->width > grid->len / grid->width)
-            above = grid->data[mov + grid->width] & ~HOVERED;
-
-        // THIS WORKS
-        if (grid->data[mov+dir] & ~HOVERED & SOLID) { // is blocked
-            // change dir
-            if (!(above & LIQUID) || !above) {
-                if (!before) {
-                    if (!after) {
-                        const i32 r = (rand() % 2) ? 1 : -1;
-                        dir = r; // Before & After
-                    } else {
-                        dir = 1; // Before
-                    }
-                } else {
-                    dir = -1; // After
-                }
-            } else {
-                dir = grid->width; // Above
-            }
-        }
-        if (!(grid->data[mov+grid->width] & ~HOVERED))
-            dir = grid->width;
-        mov += dir;
+bool place_sand(Grid *grid) {
+    const i32 hovered = grid->brush.hovered;
+    const bool down = grid->tap ? IsMouseButtonPressed(MOUSE_LEFT_BUTTON)
+                                : IsMouseButtonDown(MOUSE_LEFT_BUTTON);
+    if (!down || hovered < 0) {
+        grid->brush.last = -1;
+        return false;
     }
-    grid->data[mov] = grid->data[index] & ~HOVERED;
-    grid->data[mov] |= UPDATED;
-    grid->data[index] &= HOVERED;
-    return (i32)mov;
+
+    // join up with where the mouse was last frame, tapping places single stamps
+    const i32 from = grid->tap ? hovered : grid->brush.last;
+    const u32 num = paint_stroke(grid, from, hovered, grid->selected_type);
+    grid->brush.last = hovered;
+    return num > 0;
 }
 
 // careful of memory leak!
@@ -495,87 +667,3 @@ void print_biln(const u32 num) {
     printf("0b%s\n", b);
     free(b);
 }
-
-void update_real_num_dbg(Grid * grid) {
-    u32 num = 0;
-
-    for (int i = 0; i < grid->len; ++i) {
-        if (!(grid->data[i] & ~HOVERED)) continue; // no sand
-        num++;
-    }
-    grid->dbg.num = num;
-}
-
-void update_gravity(const Grid *grid) {
-    for (int i = 0; i < grid->len; ++i) {
-        const u32 unhover = grid->data[i] & ~HOVERED;
-        if (!unhover) continue; // no sand
-        if (unhover & UPDATED) continue;
-
-        if (unhover & STILL) continue;
-
-        const i32 below_i = i - grid->width;
-
-        if ((unhover & LIQUID) && (grid->data[i + grid->width] & SOLID)) {
-            const i32 mov = displace_liquid(grid, i, 6);
-            if (mov >= 0 ) {
-                grid->data[i] = grid->data[i + grid->width] & ~HOVERED | UPDATED;
-                grid->data[i + grid->width] &= HOVERED;
-            } else {
-                flop(&grid->data[i], &grid->data[i+grid->width]);
-            }
-            continue;
-        }
-
-        if (below_i < 0) continue; // on the floor
-        if (grid->data[below_i] & ~HOVERED) {
-            const u32 before = grid->data[below_i - 1] & ~HOVERED;
-            const u32 after  = grid->data[below_i + 1] & ~HOVERED;
-
-            // flowy liquids
-            if (before && after) {
-                if (!(unhover & LIQUID)) continue;
-                i32 r = (rand() % 2) ? 1 : -1;
-                if (grid->data[i + r] & ~HOVERED) r = -r;
-                if (grid->data[i + r] & ~HOVERED) continue;
-                grid->data[i + r] = unhover | UPDATED;
-                grid->data[i] &= HOVERED;
-                continue;
-            }
-
-            const i32 t;
-
-            // sand & liquids
-            if (!before) {
-                if (!after) { // Before & After
-                    const i32 r = (rand() % 2) ? 1 : -1;
-                    const i32 target = below_i + r;
-                    grid->data[target] = unhover | UPDATED;
-                } else { // After
-                    const i32 target = below_i - 1;
-                    grid->data[target] = unhover | UPDATED;
-                }
-            } else { // Before
-                const i32 target = below_i + 1;
-                grid->data[target] = unhover | UPDATED;
-            }
-        } else {
-            grid->data[below_i] = unhover | UPDATED;
-        }
-
-        grid->data[i] &= HOVERED;
-    }
-}
-
-void reset_data(Grid *grid) {
-    free(grid->data);
-    const i32 pbb    = (i32)roundf(grid->buff_pbb);
-    const i32 width  = GRID_WIDTH  / pbb;
-    const i32 height = GRID_HEIGHT / pbb;
-    const i32 len = width * height;
-    grid->data  = calloc(len, sizeof(i32));
-    grid->pbb   = pbb;
-    grid->len   = len;
-    grid->width = width;
-    grid->num   = 0;
-}
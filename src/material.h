@@ -0,0 +1,61 @@
+#ifndef CAND_MATERIAL_H
+#define CAND_MATERIAL_H
+#include "types.h"
+
+// A cell is a u8 material id into MATERIALS, the one table the step, the renderer
+// and the palette all read, so a new material is a new line in MATERIAL_LIST
+
+// Properties
+#define LIQUID  0b00100000 // flows
+#define SOLID   0b00010000 // stacks
+#define GAS     0b00001000 // not a cell, painting it adds to the gas field (see gas.h)
+#define FLOAT   0b00000100 // rises through heavier liquids
+#define STILL   0b00000010 // Do not move the block
+
+// id, name, properties, density, colour r g b a
+//   density decides what sinks through what, only ever compared
+#define MATERIAL_LIST(X)                                          \
+    X(EMPTY,       "Empty",    0,      0, 0,   0,   0,   0)       \
+    X(SOLID_WHITE, "Sand",     SOLID,  3, 245, 245, 245, 255)     \
+    X(SOLID_RED,   "Red Sand", SOLID,  3, 230, 41,  55,  255)     \
+    X(LIQUID_BLUE, "Water",    LIQUID, 2, 0,   121, 241, 255)     \
+    X(STILL_GREY,  "Stone",    STILL,  9, 80,  80,  80,  255)     \
+    X(FLOAT_BROWN, "Wood",     SOLID | FLOAT, 1, 127, 106, 79, 255) \
+    X(GAS_WHITE,   "Smoke",    GAS,    0, 200, 200, 200, 255)
+
+#define MATERIAL_ID(id, ...) id,
+typedef enum MaterialId {
+    MATERIAL_LIST(MATERIAL_ID)
+    MATERIALS_LEN,
+} MaterialId;
+#undef MATERIAL_ID
+
+typedef struct Material {
+    const char *name;
+    u8 flags;
+    u8 density;
+    struct {
+        u8 r, g, b, a;
+    } color;
+} Material;
+
+#define MATERIAL_ROW(id, name, flags, density, r, g, b, a) [id] = { name, flags, density, { r, g, b, a } },
+static const Material MATERIALS[MATERIALS_LEN] = {
+    MATERIAL_LIST(MATERIAL_ROW)
+};
+#undef MATERIAL_ROW
+
+// the properties of every material in one 16 byte row, for looking up a whole
+//   vector of cells at once (see simd.h), so there can be at most 16 materials
+#define FLAGS_COLUMN(id, name, flags, ...) flags,
+static const u8 MATERIAL_FLAGS[16] __attribute__((aligned(16))) = {
+    MATERIAL_LIST(FLAGS_COLUMN)
+};
+#undef FLAGS_COLUMN
+_Static_assert(MATERIALS_LEN <= 16, "MATERIAL_FLAGS holds 16 materials");
+
+static inline u8 flags_of(const u8 cell) {
+    return MATERIAL_FLAGS[cell];
+}
+
+#endif //CAND_MATERIAL_H
@@ -0,0 +1,111 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "pool.h"
+
+typedef struct Worker {
+    struct Pool *pool;
+    u32 id;
+} Worker;
+
+struct Pool {
+    pthread_t *threads;
+    Worker *workers;
+    u32 len;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+
+    PoolJob job;
+    void *arg;
+    u32 n;
+    u32 next;     // next job index to hand out
+    u32 busy;     // jobs handed out but not finished
+    u32 limit;    // threads allowed to take jobs this run, not counting the caller
+    u64 gen;      // bumped every pool_run so sleeping threads know to wake
+    bool quit;
+};
+
+// grabs jobs until there are none left, expects the lock to be held
+static void drain(Pool *pool) {
+    while (pool->next < pool->n) {
+        const u32 i = pool->next++;
+        pool->busy++;
+        pthread_mutex_unlock(&pool->lock);
+        pool->job(pool->arg, i);
+        pthread_mutex_lock(&pool->lock);
+        pool->busy--;
+    }
+    if (!pool->busy) pthread_cond_broadcast(&pool->done);
+}
+
+static void *worker(void *p) {
+    const Worker *self = p;
+    Pool *pool = self->pool;
+    u64 seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->gen == seen && !pool->quit) pthread_cond_wait(&pool->start, &pool->lock);
+        if (pool->quit) break;
+        seen = pool->gen;
+        if (self->id < pool->limit) drain(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+Pool *new_pool(const u32 threads) {
+    Pool *pool = calloc(1, sizeof(Pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    pool->threads = calloc(threads ? threads : 1, sizeof(pthread_t));
+    pool->workers = calloc(threads ? threads : 1, sizeof(Worker));
+    for (u32 i = 0; i < threads; ++i) {
+        pool->workers[i] = (Worker){ .pool = pool, .id = i };
+        // without thread support (eg: a plain wasm build) the caller does all the work
+        if (pthread_create(&pool->threads[i], NULL, worker, &pool->workers[i]) != 0) break;
+        pool->len++;
+    }
+    return pool;
+}
+
+void free_pool(Pool *pool) {
+    if (!pool) return;
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (u32 i = 0; i < pool->len; ++i) pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+}
+
+void pool_run(Pool *pool, const PoolJob job, void *arg, const u32 n, const u32 threads) {
+    if (!pool || !pool->len || n <= 1 || threads <= 1) {
+        for (u32 i = 0; i < n; ++i) job(arg, i);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->job  = job;
+    pool->arg  = arg;
+    pool->n    = n;
+    pool->next = 0;
+    pool->limit = threads - 1;
+    pool->gen++;
+    pthread_cond_broadcast(&pool->start);
+
+    drain(pool);
+    while (pool->busy || pool->next < pool->n) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
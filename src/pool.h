@@ -0,0 +1,18 @@
+#ifndef CAND_POOL_H
+#define CAND_POOL_H
+#include "types.h"
+
+// Fixed set of worker threads that sleep between calls to pool_run
+
+typedef struct Pool Pool;
+typedef void (*PoolJob)(void *arg, u32 i);
+
+// threads is the number of extra threads, the caller of pool_run also does work
+Pool *new_pool(u32 threads);
+void free_pool(Pool *pool);
+
+// runs job(arg, i) for every i in [0, n) on at most threads threads (the caller
+//   included) and returns once all of them are done
+void pool_run(Pool *pool, PoolJob job, void *arg, u32 n, u32 threads);
+
+#endif //CAND_POOL_H
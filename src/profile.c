@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "profile.h"
+
+const char *PROF_NAMES[PROF_PHASES] = {
+    [PROF_TPS]        = "update_tps",
+    [PROF_HOVER]      = "update_hovered_tile",
+    [PROF_PLACE]      = "place_sand",
+    [PROF_GRAVITY]    = "update_gravity",
+    [PROF_DRAW_GRID]  = "draw_grid",
+    [PROF_SIDE_PANEL] = "draw_side_panel",
+};
+
+static u64 now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+void prof_begin(Profiler *prof, const ProfPhase phase) {
+    prof->start[phase] = now_ns();
+}
+
+void prof_end(Profiler *prof, const ProfPhase phase) {
+    prof->frames[prof->head].ns[phase] += now_ns() - prof->start[phase];
+}
+
+void prof_add(Profiler *prof, const ProfPhase phase, const u64 ns) {
+    prof->frames[prof->head].ns[phase] += ns;
+}
+
+void prof_frame(Profiler *prof, const u32 ticks, const StepCounts counts) {
+    ProfFrame *frame = &prof->frames[prof->head];
+    frame->ticks  = ticks;
+    frame->counts = counts;
+    prof->head = (prof->head + 1) % (PROF_FRAMES + 1);
+    if (prof->len < PROF_FRAMES) prof->len++;
+    prof->frames[prof->head] = (ProfFrame){0};
+}
+
+// the i-th oldest kept frame
+static const ProfFrame *frame_at(const Profiler *prof, const u32 i) {
+    return &prof->frames[(prof->head + PROF_FRAMES + 1 - prof->len + i) % (PROF_FRAMES + 1)];
+}
+
+static i32 cmp_u64(const void *a, const void *b) {
+    const u64 x = *(const u64 *)a, y = *(const u64 *)b;
+    return (x > y) - (x < y);
+}
+
+ProfStats prof_stats(const Profiler *prof, const ProfPhase phase) {
+    if (!prof->len) return (ProfStats){0};
+    static u64 ns[PROF_FRAMES];
+    u64 sum = 0;
+    for (u32 i = 0; i < prof->len; ++i) {
+        ns[i] = frame_at(prof, i)->ns[phase];
+        sum += ns[i];
+    }
+    qsort(ns, prof->len, sizeof(u64), cmp_u64);
+    return (ProfStats){
+        .min = (f64)ns[0] * 1e-6,
+        .avg = (f64)sum / prof->len * 1e-6,
+        .p99 = (f64)ns[(prof->len - 1) * 99 / 100] * 1e-6,
+    };
+}
+
+StepCounts prof_counts(const Profiler *prof) {
+    if (!prof->len) return (StepCounts){0};
+    u64 visited = 0, moved = 0, displaced = 0, blocked = 0;
+    for (u32 i = 0; i < prof->len; ++i) {
+        const StepCounts *c = &frame_at(prof, i)->counts;
+        visited   += c->visited;
+        moved     += c->moved;
+        displaced += c->displaced;
+        blocked   += c->blocked;
+    }
+    return (StepCounts){
+        .visited   = (u32)(visited   / prof->len),
+        .moved     = (u32)(moved     / prof->len),
+        .displaced = (u32)(displaced / prof->len),
+        .blocked   = (u32)(blocked   / prof->len),
+    };
+}
+
+// one row per frame, oldest first, times in ms
+bool prof_dump_csv(const Profiler *prof, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) return false;
+    fprintf(file, "frame");
+    for (u32 p = 0; p < PROF_PHASES; ++p) fprintf(file, ",%s", PROF_NAMES[p]);
+    fprintf(file, ",ticks,visited,moved,displaced,blocked\n");
+    for (u32 i = 0; i < prof->len; ++i) {
+        const ProfFrame *frame = frame_at(prof, i);
+        fprintf(file, "%u", i);
+        for (u32 p = 0; p < PROF_PHASES; ++p) fprintf(file, ",%.4f", (f64)frame->ns[p] * 1e-6);
+        fprintf(file, ",%u,%u,%u,%u,%u\n", frame->ticks, frame->counts.visited, frame->counts.moved,
+            frame->counts.displaced, frame->counts.blocked);
+    }
+    return fclose(file) == 0;
+}
@@ -0,0 +1,60 @@
+#ifndef CAND_PROFILE_H
+#define CAND_PROFILE_H
+#include <stdbool.h>
+#include "types.h"
+#include "sim.h"
+
+// Per phase frame timings and step counters of the last PROF_FRAMES frames,
+// for finding out where a slow frame went (the dbg panel shows a summary,
+// prof_dump_csv writes the whole history)
+
+#define PROF_FRAMES 600 // ten seconds at 60 fps
+
+typedef enum ProfPhase {
+    PROF_TPS,
+    PROF_HOVER,
+    PROF_PLACE,
+    PROF_GRAVITY,
+    PROF_DRAW_GRID,
+    PROF_SIDE_PANEL,
+    PROF_PHASES,
+} ProfPhase;
+
+extern const char *PROF_NAMES[PROF_PHASES];
+
+typedef struct ProfFrame {
+    u64 ns[PROF_PHASES];
+    u32 ticks;
+    StepCounts counts;
+} ProfFrame;
+
+typedef struct Profiler {
+    ProfFrame frames[PROF_FRAMES + 1];  // the kept frames and the one being timed
+    u32 head;  // frame being timed
+    u32 len;   // finished frames kept, up to PROF_FRAMES
+    u64 start[PROF_PHASES];
+} Profiler;
+
+typedef struct ProfStats {
+    f64 min;   // in ms
+    f64 avg;
+    f64 p99;
+} ProfStats;
+
+// times the statement or block after it as phase, a return or break inside skips the end
+#define PROF_SCOPE(prof, phase) \
+    for (u32 prof_once_ = (prof_begin(prof, phase), 1); prof_once_; prof_once_ = (prof_end(prof, phase), 0))
+
+void prof_begin(Profiler *prof, ProfPhase phase);
+void prof_end(Profiler *prof, ProfPhase phase);
+// for time measured elsewhere, eg: ticks stepped on the sim thread
+void prof_add(Profiler *prof, ProfPhase phase, u64 ns);
+// closes the frame being timed with what the step did during it
+void prof_frame(Profiler *prof, u32 ticks, StepCounts counts);
+
+ProfStats prof_stats(const Profiler *prof, ProfPhase phase);
+// the counters per frame, averaged over the kept frames
+StepCounts prof_counts(const Profiler *prof);
+bool prof_dump_csv(const Profiler *prof, const char *path);
+
+#endif //CAND_PROFILE_H
@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include "record.h"
+#include "sim.h"
+
+static void put_varint(FILE *file, u64 v) {
+    while (v >= 0x80) {
+        fputc((i32)(v & 0x7f) | 0x80, file);
+        v >>= 7;
+    }
+    fputc((i32)v, file);
+}
+
+static bool get_varint(FILE *file, u64 *v) {
+    *v = 0;
+    for (u32 shift = 0; shift < 64; shift += 7) {
+        const i32 c = fgetc(file);
+        if (c == EOF) return false;
+        *v |= (u64)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+static void put_u32(FILE *file, const u32 v) {
+    const u8 b[4] = { v, v >> 8, v >> 16, v >> 24 };
+    fwrite(b, 1, sizeof(b), file);
+}
+
+static bool get_u32(FILE *file, u32 *v) {
+    u8 b[4];
+    if (fread(b, 1, sizeof(b), file) != sizeof(b)) return false;
+    *v = (u32)b[0] | (u32)b[1] << 8 | (u32)b[2] << 16 | (u32)b[3] << 24;
+    return true;
+}
+
+Recorder *start_recording(Grid *grid, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) return NULL;
+
+    stop_recording(grid);
+    reset_data(grid);
+
+    fwrite("CREC", 1, 4, file);
+    put_u32(file, REC_VERSION);
+    put_u32(file, grid->px_width);
+    put_u32(file, grid->px_height);
+    put_u32(file, grid->pbb);
+    put_u32(file, (u32)grid->seed);
+    put_u32(file, (u32)(grid->seed >> 32));
+
+    Recorder *rec = calloc(1, sizeof(Recorder));
+    rec->file = file;
+    grid->rec = rec;
+    return rec;
+}
+
+static void flush_ticks(Recorder *rec) {
+    if (!rec->ticks) return;
+    fputc(REC_TICK, rec->file);
+    put_varint(rec->file, rec->ticks);
+    rec->ticks = 0;
+}
+
+void stop_recording(Grid *grid) {
+    Recorder *rec = grid->rec;
+    if (!rec) return;
+    flush_ticks(rec);
+    fclose(rec->file);
+    free(rec);
+    grid->rec = NULL;
+}
+
+void record_tick(Recorder *rec, const i32 engine) {
+    if (engine != rec->engine) {
+        flush_ticks(rec);
+        fputc(REC_ENGINE, rec->file);
+        put_varint(rec->file, (u64)engine);
+        rec->engine = engine;
+    }
+    rec->ticks++;
+}
+
+void record_stroke(Recorder *rec, const i32 from, const i32 to, const u32 type,
+    const u32 radius, const i32 shape) {
+    flush_ticks(rec);
+    fputc(REC_STROKE, rec->file);
+    put_varint(rec->file, (u64)(from + 1)); // -1 => no previous stamp
+    put_varint(rec->file, (u64)to);
+    put_varint(rec->file, type);
+    put_varint(rec->file, radius);
+    put_varint(rec->file, (u64)shape);
+}
+
+void record_fill(Recorder *rec, const u32 x, const u32 y, const u32 w, const u32 h, const u32 type) {
+    flush_ticks(rec);
+    fputc(REC_FILL, rec->file);
+    put_varint(rec->file, x);
+    put_varint(rec->file, y);
+    put_varint(rec->file, w);
+    put_varint(rec->file, h);
+    put_varint(rec->file, type);
+}
+
+void record_reset(Recorder *rec, const i32 pbb) {
+    flush_ticks(rec);
+    fputc(REC_RESET, rec->file);
+    put_varint(rec->file, (u64)pbb);
+}
+
+bool read_rec_header(FILE *file, RecHeader *header) {
+    char magic[4];
+    if (fread(magic, 1, 4, file) != 4) return false;
+    if (magic[0] != 'C' || magic[1] != 'R' || magic[2] != 'E' || magic[3] != 'C') return false;
+
+    u32 lo, hi;
+    if (!get_u32(file, &header->version) || header->version != REC_VERSION) return false;
+    if (!get_u32(file, &header->px_width))  return false;
+    if (!get_u32(file, &header->px_height)) return false;
+    if (!get_u32(file, &header->pbb) || !header->pbb || header->pbb > MAX_PBB) return false;
+    if (!get_u32(file, &lo) || !get_u32(file, &hi)) return false;
+    header->seed = (u64)hi << 32 | lo;
+    return true;
+}
+
+u8 read_rec_event(FILE *file, u64 args[5]) {
+    const i32 op = fgetc(file);
+    u32 argc = 0;
+    switch (op) {
+        case REC_TICK:   argc = 1; break;
+        case REC_STROKE: argc = 5; break;
+        case REC_FILL:   argc = 5; break;
+        case REC_RESET:  argc = 1; break;
+        case REC_ENGINE: argc = 1; break;
+        default: return 0;
+    }
+    for (u32 i = 0; i < argc; ++i) {
+        if (!get_varint(file, &args[i])) return 0;
+    }
+    return (u8)op;
+}
@@ -0,0 +1,58 @@
+#ifndef CAND_RECORD_H
+#define CAND_RECORD_H
+#include <stdio.h>
+#include <stdbool.h>
+#include "types.h"
+
+// Input log of a grid, replaying it from an empty grid with the same seed
+// steps to the exact same cells (see replay.c)
+/*
+    header: "CREC" u32 version, u32 px_width, u32 px_height, u32 pbb, u64 seed
+    then events, an u8 op followed by its args as varints:
+        REC_TICK   n                              n ticks of update_gravity
+        REC_STROKE from + 1, to, type, radius, shape   type is a material id
+        REC_FILL   x, y, w, h, type
+        REC_RESET  pbb
+        REC_ENGINE engine                         the StepEngine of the ticks after it
+*/
+
+#define REC_VERSION 3
+
+typedef enum RecOp {
+    REC_TICK = 1,
+    REC_STROKE,
+    REC_FILL,
+    REC_RESET,
+    REC_ENGINE,
+} RecOp;
+
+typedef struct Recorder {
+    FILE *file;
+    u32 ticks; // ticks not written yet, runs of ticks are written as one event
+    i32 engine; // of the ticks written, a log starts on ENGINE_GRAVITY
+} Recorder;
+
+struct Grid;
+
+// the grid is reset, so the log always starts from an empty grid
+Recorder *start_recording(struct Grid *grid, const char *path);
+void stop_recording(struct Grid *grid);
+
+void record_tick(Recorder *rec, i32 engine);
+void record_stroke(Recorder *rec, i32 from, i32 to, u32 type, u32 radius, i32 shape);
+void record_fill(Recorder *rec, u32 x, u32 y, u32 w, u32 h, u32 type);
+void record_reset(Recorder *rec, i32 pbb);
+
+typedef struct RecHeader {
+    u32 version;
+    u32 px_width;
+    u32 px_height;
+    u32 pbb;
+    u64 seed;
+} RecHeader;
+
+bool read_rec_header(FILE *file, RecHeader *header);
+// reads the next op and up to 5 args, returns 0 at the end of the log
+u8 read_rec_event(FILE *file, u64 args[5]);
+
+#endif //CAND_RECORD_H
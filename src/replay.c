@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "scenes.h"
+#include "snapshot.h"
+
+// Headless replayer for logs written by record.c
+//   usage: replay <log.rec> [every] [golden]
+//            prints "tick hash" every `every` ticks, replays both serial and with
+//            MAX_THREADS and fails if they differ or if they differ from golden
+//          replay record <scene> <ticks> <ppb> <out.rec>
+//            runs a scene from scenes.c while recording it, for making new traces
+//          replay snap <log.rec> <out.snap>
+//            saves where the log ends up, for using it as a bench world
+
+#define MAX_HASHES 4096
+
+typedef struct Trace {
+    u64 tick[MAX_HASHES];
+    u64 hash[MAX_HASHES];
+    u32 len;
+} Trace;
+
+static void push_hash(Trace *trace, const u64 tick, const u64 hash) {
+    if (trace->len >= MAX_HASHES) return;
+    trace->tick[trace->len] = tick;
+    trace->hash[trace->len] = hash;
+    trace->len++;
+}
+
+// a material id from a log, EMPTY (paints nothing) when it isn't one
+static u8 material_arg(const u64 arg) {
+    return arg < MATERIALS_LEN ? (u8)arg : EMPTY;
+}
+
+// steps the grid through the whole log, hashing every `every` ticks and at the end,
+//   when snap is set the final grid is saved to it
+static bool replay(const char *path, const u32 cores, const u32 every, Trace *trace, const char *snap) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "replay: cannot open %s\n", path);
+        return false;
+    }
+    RecHeader header;
+    if (!read_rec_header(file, &header)) {
+        fprintf(stderr, "replay: %s is not a v%d log\n", path, REC_VERSION);
+        fclose(file);
+        return false;
+    }
+
+    Grid grid = new_grid((i32)header.px_width, (i32)header.px_height, (i32)header.pbb);
+    grid.seed  = header.seed;
+    grid.cores = cores;
+    trace->len = 0;
+
+    bool ok = true;
+    if (!grid.len) {
+        fprintf(stderr, "replay: %s starts from a grid that can't be made\n", path);
+        ok = false;
+    }
+    u64 args[5];
+    u8 op;
+    while (ok && (op = read_rec_event(file, args))) {
+        switch (op) {
+            case REC_TICK:
+                for (u64 n = 0; n < args[0]; ++n) {
+                    update_gravity(&grid);
+                    if (grid.tick % every == 0) push_hash(trace, grid.tick, hash_grid(&grid));
+                }
+                break;
+            case REC_STROKE:
+                grid.brush.radius = (u32)args[3];
+                grid.brush.shape  = (i32)args[4];
+                paint_stroke(&grid, (i32)args[0] - 1, (i32)args[1], material_arg(args[2]));
+                break;
+            case REC_FILL:
+                fill_rect(&grid, (u32)args[0], (u32)args[1], (u32)args[2], (u32)args[3], material_arg(args[4]));
+                break;
+            case REC_RESET:
+                grid.buff_pbb = (f32)args[0];
+                if (!reset_data(&grid)) {
+                    fprintf(stderr, "replay: %s resets to a grid that can't be made\n", path);
+                    ok = false;
+                }
+                break;
+            case REC_ENGINE:
+                grid.engine = args[0] < ENGINES_LEN ? (i32)args[0] : ENGINE_GRAVITY;
+                break;
+        }
+    }
+    if (!trace->len || trace->tick[trace->len - 1] != grid.tick) {
+        push_hash(trace, grid.tick, hash_grid(&grid));
+    }
+
+    if (ok && snap && !save_snapshot(&grid, snap)) {
+        fprintf(stderr, "replay: cannot write %s\n", snap);
+        ok = false;
+    }
+    fclose(file);
+    free_grid(&grid);
+    return ok;
+}
+
+static bool read_golden(const char *path, Trace *trace) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "replay: cannot open %s\n", path);
+        return false;
+    }
+    trace->len = 0;
+    unsigned long long tick, hash;
+    while (trace->len < MAX_HASHES && fscanf(file, "%llu %llx", &tick, &hash) == 2) {
+        push_hash(trace, tick, hash);
+    }
+    fclose(file);
+    return true;
+}
+
+// returns the index of the first hash that differs, or -1 if the traces match
+static i32 compare(const Trace *a, const Trace *b) {
+    const u32 len = a->len < b->len ? a->len : b->len;
+    for (u32 i = 0; i < len; ++i) {
+        if (a->tick[i] != b->tick[i] || a->hash[i] != b->hash[i]) return (i32)i;
+    }
+    return a->len == b->len ? -1 : (i32)len;
+}
+
+static i32 record(const char *name, const u32 ticks, const i32 ppb, const char *path) {
+    const Scene *scene = find_scene(name);
+    if (!scene) {
+        fprintf(stderr, "replay: no scene named %s\n", name);
+        return 1;
+    }
+    Grid grid = new_grid(800, 600, ppb);
+    grid.seed = 1;
+    if (!start_recording(&grid, path)) {
+        fprintf(stderr, "replay: cannot write %s\n", path);
+        free_grid(&grid);
+        return 1;
+    }
+
+    scene->init(&grid);
+    for (u32 t = 0; t < ticks; ++t) {
+        scene->tick(&grid, t);
+        update_gravity(&grid);
+    }
+    stop_recording(&grid);
+    free_grid(&grid);
+    return 0;
+}
+
+static Trace serial, parallel, golden;
+
+i32 main(const i32 argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "record") == 0) {
+        if (argc < 6) {
+            fprintf(stderr, "usage: replay record <scene> <ticks> <ppb> <out.rec>\n");
+            return 1;
+        }
+        return record(argv[2], (u32)strtoul(argv[3], NULL, 10), (i32)strtol(argv[4], NULL, 10), argv[5]);
+    }
+    if (argc > 1 && strcmp(argv[1], "snap") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "usage: replay snap <log.rec> <out.snap>\n");
+            return 1;
+        }
+        return replay(argv[2], MAX_THREADS, 50, &serial, argv[3]) ? 0 : 1;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: replay <log.rec> [every] [golden]\n");
+        return 1;
+    }
+
+    const char *path = argv[1];
+    const u32 every = argc > 2 && strtoul(argv[2], NULL, 10) ? (u32)strtoul(argv[2], NULL, 10) : 50;
+
+    if (!replay(path, 1, every, &serial, NULL) || !replay(path, MAX_THREADS, every, &parallel, NULL)) return 1;
+
+    i32 at = compare(&serial, &parallel);
+    if (at >= 0) {
+        fprintf(stderr, "%s: serial and %d cores differ at tick %llu\n",
+            path, MAX_THREADS, (unsigned long long)serial.tick[at]);
+        return 1;
+    }
+
+    if (argc > 3) {
+        if (!read_golden(argv[3], &golden)) return 1;
+        at = compare(&serial, &golden);
+        if (at >= 0) {
+            fprintf(stderr, "%s: differs from %s at tick %llu\n",
+                path, argv[3], (unsigned long long)(at < (i32)serial.len ? serial.tick[at] : golden.tick[at]));
+            return 1;
+        }
+        printf("%s: ok, %u hashes over %llu ticks\n",
+            path, serial.len, (unsigned long long)serial.tick[serial.len - 1]);
+        return 0;
+    }
+
+    for (u32 i = 0; i < serial.len; ++i) {
+        printf("%llu %016llx\n", (unsigned long long)serial.tick[i], (unsigned long long)serial.hash[i]);
+    }
+    return 0;
+}
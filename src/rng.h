@@ -0,0 +1,38 @@
+#ifndef CAND_RNG_H
+#define CAND_RNG_H
+#include "types.h"
+
+// Small seedable generator for the step, every strip of the grid gets its own
+// stream so the result doesn't depend on which thread stepped it
+
+typedef struct Rng {
+    u64 s;
+} Rng;
+
+static inline u64 splitmix64(u64 x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// the same seed and stream always give the same numbers
+static inline Rng new_rng(const u64 seed, const u64 stream) {
+    const Rng rng = { splitmix64(seed ^ splitmix64(stream)) | 1 };
+    return rng;
+}
+
+// xorshift64*
+static inline u32 rng_next(Rng *rng) {
+    rng->s ^= rng->s >> 12;
+    rng->s ^= rng->s << 25;
+    rng->s ^= rng->s >> 27;
+    return (u32)((rng->s * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+// -1 or 1, for picking left or right
+static inline i32 rng_dir(Rng *rng) {
+    return (rng_next(rng) >> 31) ? 1 : -1;
+}
+
+#endif //CAND_RNG_H
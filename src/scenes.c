@@ -0,0 +1,94 @@
+#include <string.h>
+#include "scenes.h"
+
+static void pour(Grid *grid, const u32 x, const u8 type) {
+    const u32 height = grid->len / grid->width;
+    const u32 r = grid->width / 40 + 1;
+    fill_rect(grid, x - r, height - 2, r * 2, 2, type);
+}
+
+static void init_none(Grid *grid) { (void)grid; }
+
+static void tick_sand_pile(Grid *grid, const u32 t) {
+    (void)t;
+    pour(grid, grid->width / 2, SOLID_WHITE);
+}
+
+static void init_water_tank(Grid *grid) {
+    const u32 height = grid->len / grid->width;
+    fill_rect(grid, 0, 0, grid->width, height * 2 / 3, LIQUID_BLUE);
+}
+
+static void tick_water_tank(Grid *grid, const u32 t) {
+    if (t % 4 == 0) pour(grid, grid->width / 3, SOLID_RED);
+}
+
+static void init_mixed(Grid *grid) {
+    const u32 height = grid->len / grid->width;
+    const u32 w = grid->width;
+    fill_rect(grid, 0,         0,              w / 2, height / 4, LIQUID_BLUE);
+    fill_rect(grid, w / 8,     height / 3,     w / 3, 1,          STILL_GREY);
+    fill_rect(grid, w / 2,     height / 2,     w / 3, 1,          STILL_GREY);
+    fill_rect(grid, w / 6,     height * 2 / 3, w / 4, height / 4, SOLID_WHITE);
+    fill_rect(grid, w * 5 / 9, height * 2 / 3, w / 4, height / 4, SOLID_RED);
+}
+
+static void tick_mixed(Grid *grid, const u32 t) {
+    if (t % 2 == 0) pour(grid, grid->width * 3 / 4, LIQUID_BLUE);
+}
+
+static void tick_mostly_empty(Grid *grid, const u32 t) {
+    if (t % 8 == 0) fill_rect(grid, (t * 7) % grid->width, grid->len / grid->width - 1, 1, 1, SOLID_WHITE);
+}
+
+// drags a circle brush back and forth across the top, like a player would
+static void tick_brush(Grid *grid, const u32 t) {
+    const u32 height = grid->len / grid->width;
+    const u32 w = grid->width;
+    const u32 x0 = (t * 5) % w, x1 = ((t + 1) * 5) % w;
+    grid->brush.radius = 3;
+    grid->brush.shape  = BRUSH_CIRCLE;
+    if (x1 < x0) return;
+    paint_stroke(grid, (i32)(x0 + (height - 4) * w), (i32)(x1 + (height - 4) * w), t % 32 < 16 ? SOLID_RED : LIQUID_BLUE);
+}
+
+// a log of wood under water rises through it, wood poured in floats, smoke
+//   rises from the dry side and spreads under the top
+static void init_float_smoke(Grid *grid) {
+    const u32 height = grid->len / grid->width;
+    const u32 w = grid->width;
+    fill_rect(grid, w / 12,    0, 1,             height * 3 / 4, STILL_GREY);
+    fill_rect(grid, w * 2 / 3, 0, 1,             height * 3 / 4, STILL_GREY);
+    fill_rect(grid, w / 8,     0, w / 4,         height / 8,     FLOAT_BROWN);
+    fill_rect(grid, w / 12,    0, w * 2 / 3 - w / 12, height / 2, LIQUID_BLUE);
+}
+
+static void tick_float_smoke(Grid *grid, const u32 t) {
+    const u32 w = grid->width;
+    if (t % 8 == 0) pour(grid, w / 3, FLOAT_BROWN);
+    fill_rect(grid, w * 5 / 6, 0, w / 20 + 1, 2, GAS_WHITE);
+}
+
+// mixed again on the block engine, to hold its look and speed against the sweep
+static void init_mixed_blocks(Grid *grid) {
+    grid->engine = ENGINE_BLOCKS;
+    init_mixed(grid);
+}
+
+const Scene SCENES[] = {
+    { "sand_pile",    init_none,       tick_sand_pile    },
+    { "water_tank",   init_water_tank, tick_water_tank   },
+    { "mixed",        init_mixed,      tick_mixed        },
+    { "mostly_empty", init_none,       tick_mostly_empty },
+    { "brush",        init_none,       tick_brush        },
+    { "float_smoke",  init_float_smoke, tick_float_smoke },
+    { "mixed_blocks", init_mixed_blocks, tick_mixed      },
+};
+const u32 SCENES_LEN = sizeof(SCENES) / sizeof(Scene);
+
+const Scene *find_scene(const char *name) {
+    for (u32 i = 0; i < SCENES_LEN; ++i) {
+        if (strcmp(SCENES[i].name, name) == 0) return &SCENES[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,18 @@
+#ifndef CAND_SCENES_H
+#define CAND_SCENES_H
+#include "sim.h"
+
+// Scripted input for running the grid headless, shared by bench and replay
+
+typedef struct Scene {
+    const char *name;
+    void (*init)(Grid *grid);
+    void (*tick)(Grid *grid, u32 t);   // scripted input, called before every step
+} Scene;
+
+extern const Scene SCENES[];
+extern const u32 SCENES_LEN;
+
+const Scene *find_scene(const char *name);
+
+#endif //CAND_SCENES_H
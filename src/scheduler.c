@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "scheduler.h"
+
+static f64 now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+
+static void sleep_sec(const f64 sec) {
+    const struct timespec ts = {
+        .tv_sec  = (time_t)sec,
+        .tv_nsec = (long)((sec - (f64)(time_t)sec) * 1e9),
+    };
+    nanosleep(&ts, NULL);
+}
+
+Scheduler new_scheduler(void) {
+    Scheduler sched = {0};
+    pthread_mutex_init(&sched.step, NULL);
+    pthread_mutex_init(&sched.publish, NULL);
+    return sched;
+}
+
+void free_scheduler(Scheduler *sched) {
+    stop_sim_thread(sched);
+    pthread_mutex_destroy(&sched->publish);
+    pthread_mutex_destroy(&sched->step);
+}
+
+static void count_ticks(Scheduler *sched, const f64 dt, const u32 ticks) {
+    sched->rate_ticks += ticks;
+    sched->rate_time  += dt;
+    if (sched->rate_time < 1.0) return;
+    sched->rate = (u32)((f64)sched->rate_ticks / sched->rate_time + 0.5);
+    sched->rate_ticks = 0;
+    sched->rate_time  = 0;
+}
+
+u32 due_ticks(Scheduler *sched, const f64 dt, const u32 tps) {
+    if (!tps) {
+        sched->acc = 0;
+        count_ticks(sched, dt, 0);
+        return 0;
+    }
+
+    sched->acc += dt;
+    const f64 step = 1.0 / (f64)tps;
+    u32 ticks = (u32)(sched->acc / step);
+    if (ticks > MAX_TICKS_PER_FRAME) {
+        ticks = MAX_TICKS_PER_FRAME;
+        sched->acc = 0;
+    } else {
+        sched->acc -= (f64)ticks * step;
+    }
+    count_ticks(sched, dt, ticks);
+    return ticks;
+}
+
+// copies the grid into the back buffer then swaps it to the front, expects step to be held
+static void publish(Scheduler *sched) {
+    const Grid *grid = sched->grid;
+    if (sched->len != grid->len) {
+        pthread_mutex_lock(&sched->publish);
+        free(sched->front);
+        free(sched->back);
+        sched->front = calloc(grid->len, sizeof(u8));
+        sched->back  = calloc(grid->len, sizeof(u8));
+        sched->len   = grid->len;
+        pthread_mutex_unlock(&sched->publish);
+    }
+    const u32 gas_len = gas_stride(&grid->gas) * (grid->gas.h + 2);
+    if (sched->gas_len != gas_len) {
+        pthread_mutex_lock(&sched->publish);
+        free(sched->gas_front);
+        free(sched->gas_back);
+        sched->gas_front = calloc(gas_len, sizeof(u16));
+        sched->gas_back  = calloc(gas_len, sizeof(u16));
+        sched->gas_len   = gas_len;
+        pthread_mutex_unlock(&sched->publish);
+    }
+    memcpy(sched->back, grid->data, grid->len * sizeof(u8));
+    memcpy(sched->gas_back, grid->gas.d, gas_len * sizeof(u16));
+
+    pthread_mutex_lock(&sched->publish);
+    u8 *front = sched->front;
+    sched->front = sched->back;
+    sched->back  = front;
+    u16 *gas_front = sched->gas_front;
+    sched->gas_front = sched->gas_back;
+    sched->gas_back  = gas_front;
+    sched->width = grid->width;
+    pthread_mutex_unlock(&sched->publish);
+}
+
+static void *sim_thread(void *p) {
+    Scheduler *sched = p;
+    Grid *grid = sched->grid;
+    f64 last = now_sec();
+
+    for (;;) {
+        const f64 t = now_sec();
+        const f64 dt = t - last;
+        last = t;
+
+        pthread_mutex_lock(&sched->step);
+        if (sched->quit) {
+            pthread_mutex_unlock(&sched->step);
+            break;
+        }
+
+        u32 ticks = 0;
+        if (grid->man_step) {
+            ticks = sched->pending;
+            sched->pending = 0;
+            count_ticks(sched, dt, ticks);
+        } else {
+            ticks = due_ticks(sched, dt, grid->tps);
+        }
+        const f64 start = now_sec();
+        for (u32 i = 0; i < ticks; ++i) update_gravity(grid);
+        sched->step_sec += now_sec() - start;
+
+        if (ticks || sched->dirty) publish(sched);
+        sched->dirty = false;
+        const u32 tps = grid->man_step ? 0 : grid->tps;
+        const f64 acc = sched->acc;
+        pthread_mutex_unlock(&sched->step);
+
+        // wake up for the next tick, but often enough to notice input and tps changes
+        f64 wait = 0.004;
+        if (tps && 1.0 / tps - acc < wait) wait = 1.0 / tps - acc;
+        if (wait > 0) sleep_sec(wait);
+    }
+    return NULL;
+}
+
+static void free_publish(Scheduler *sched) {
+    free(sched->front);
+    free(sched->back);
+    free(sched->gas_front);
+    free(sched->gas_back);
+    sched->front = NULL;
+    sched->back  = NULL;
+    sched->gas_front = NULL;
+    sched->gas_back  = NULL;
+    sched->len   = 0;
+    sched->gas_len = 0;
+}
+
+void start_sim_thread(Scheduler *sched, Grid *grid) {
+    if (sched->threaded) return;
+    sched->grid  = grid;
+    sched->quit  = false;
+    sched->dirty = true;
+    sched->acc   = 0;
+
+    pthread_mutex_lock(&sched->step);
+    publish(sched);
+    pthread_mutex_unlock(&sched->step);
+
+    sched->threaded = pthread_create(&sched->thread, NULL, sim_thread, sched) == 0;
+    // without threads (the plain web build) the grid stays stepped in the frame,
+    //   and want_thread is dropped so the next frame doesn't try again
+    if (!sched->threaded) {
+        sched->want_thread = false;
+        free_publish(sched);
+    }
+}
+
+void stop_sim_thread(Scheduler *sched) {
+    if (!sched->threaded) return;
+    pthread_mutex_lock(&sched->step);
+    sched->quit = true;
+    pthread_mutex_unlock(&sched->step);
+    pthread_join(sched->thread, NULL);
+    sched->threaded = false;
+    sched->acc = 0;
+    free_publish(sched);
+}
+
+void lock_grid(Scheduler *sched) {
+    if (sched->threaded) pthread_mutex_lock(&sched->step);
+}
+
+void unlock_grid(Scheduler *sched) {
+    if (sched->threaded) pthread_mutex_unlock(&sched->step);
+}
+
+const u8 *acquire_frame(Scheduler *sched, u32 *len, u32 *width, const u16 **gas) {
+    pthread_mutex_lock(&sched->publish);
+    *len   = sched->len;
+    *width = sched->width;
+    *gas   = sched->gas_front;
+    return sched->front;
+}
+
+void release_frame(Scheduler *sched) {
+    pthread_mutex_unlock(&sched->publish);
+}
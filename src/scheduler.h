@@ -0,0 +1,57 @@
+#ifndef CAND_SCHEDULER_H
+#define CAND_SCHEDULER_H
+#include <pthread.h>
+#include "sim.h"
+
+// Fixed timestep for update_gravity, either driven by the render loop or on
+// its own thread that hands finished grids to the renderer
+
+// time past this is dropped, so a slow tick can't snowball into ever more ticks
+static const u32 MAX_TICKS_PER_FRAME = 8;
+
+typedef struct Scheduler {
+    f64 acc;        // seconds of simulation not stepped yet
+    u32 rate;       // ticks done over the last second
+    u32 rate_ticks;
+    f64 rate_time;
+
+    // sim thread
+    Grid *grid;
+    pthread_t thread;
+    pthread_mutex_t step;     // held while the grid is stepped, take it before touching the grid
+    pthread_mutex_t publish;  // guards front
+    u8 *front;                // last published copy of grid->data, what gets drawn
+    u8 *back;
+    u16 *gas_front;           // the same for grid->gas.d
+    u16 *gas_back;
+    u32 len;
+    u32 gas_len;
+    u32 width;
+    u32 pending;              // manual steps asked for by the render loop
+    f64 step_sec;             // time spent in update_gravity since the render loop last took it
+    bool dirty;               // the render loop changed the grid, publish even without a tick
+    bool want_thread;         // set from the gui, applied by the render loop outside of the lock
+    bool threaded;
+    bool quit;
+} Scheduler;
+
+Scheduler new_scheduler(void);
+void free_scheduler(Scheduler *sched);
+
+// how many ticks are due after dt more seconds at tps
+u32 due_ticks(Scheduler *sched, f64 dt, u32 tps);
+
+// when the thread can't be started, want_thread is cleared and the grid stays
+//   stepped by the caller
+void start_sim_thread(Scheduler *sched, Grid *grid);
+void stop_sim_thread(Scheduler *sched);
+
+// no-ops unless the sim thread is running
+void lock_grid(Scheduler *sched);
+void unlock_grid(Scheduler *sched);
+
+// the newest published grid and its gas field, release it when done reading
+const u8 *acquire_frame(Scheduler *sched, u32 *len, u32 *width, const u16 **gas);
+void release_frame(Scheduler *sched);
+
+#endif //CAND_SCHEDULER_H
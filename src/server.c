@@ -0,0 +1,202 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "scenes.h"
+#include "snapshot.h"
+#include "scheduler.h"
+#include "stream.h"
+
+// Headless server, steps a grid in real time and streams it to a viewer (see stream.h)
+//   usage: server [addr] [scene|world.snap|-] [width height]
+//   addr is host:port, :port for every interface or a path for a unix socket,
+//   STREAM_ADDR without. A scene keeps playing its scripted input, a snapshot
+//   starts from its cells, - (the default) from an empty 800x600 cell grid.
+//   One viewer at a time paints into the grid, which keeps stepping without one.
+//   Prints the ticks and what was sent every few seconds
+
+// the largest brush a viewer can paint with, as the gui's slider
+#define MAX_RADIUS 100
+#define STATS_EVERY 5.0
+
+static volatile sig_atomic_t quit;
+
+static void on_signal(const i32 sig) {
+    (void)sig;
+    quit = 1;
+}
+
+static f64 now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (f64)ts.tv_sec + (f64)ts.tv_nsec * 1e-9;
+}
+
+static void sleep_sec(const f64 sec) {
+    const struct timespec ts = {
+        .tv_sec  = (time_t)sec,
+        .tv_nsec = (long)((sec - (f64)(time_t)sec) * 1e9),
+    };
+    nanosleep(&ts, NULL);
+}
+
+static bool is_snapshot(const char *arg) {
+    const size_t len = strlen(arg);
+    return len > 5 && strcmp(arg + len - 5, ".snap") == 0;
+}
+
+// a material id from the viewer, EMPTY (paints nothing) when it isn't one
+static u8 material_arg(const u64 arg) {
+    return arg < MATERIALS_LEN ? (u8)arg : EMPTY;
+}
+
+// the viewer's input, returns true when the grid was reset
+static bool read_input(Stream *viewer, Grid *grid) {
+    bool reset = false;
+    const u8 *body;
+    size_t len;
+    u8 op;
+    u64 args[5];
+    while ((op = stream_next(viewer, &body, &len))) {
+        switch (op) {
+            case STREAM_STROKE:
+                if (!stream_args(body, len, args, 5) || args[1] >= grid->len) break;
+                grid->brush.radius = args[3] < MAX_RADIUS ? (u32)args[3] : MAX_RADIUS;
+                grid->brush.shape  = (i32)(args[4] == BRUSH_CIRCLE);
+                paint_stroke(grid, (i32)(args[0] <= grid->len ? args[0] : 0) - 1, (i32)args[1], material_arg(args[2]));
+                break;
+            case STREAM_RESET:
+                reset_data(grid);
+                reset = true;
+                break;
+        }
+    }
+    return reset;
+}
+
+i32 main(const i32 argc, char **argv) {
+    const char *addr = argc > 1 ? argv[1] : STREAM_ADDR;
+    const char *from = argc > 2 ? argv[2] : "-";
+    const long width  = argc > 4 ? strtol(argv[3], NULL, 10) : 800;
+    const long height = argc > 4 ? strtol(argv[4], NULL, 10) : 600;
+    if (width <= 0 || height <= 0 || width > MAX_CELLS || height > MAX_CELLS ||
+        (u64)width * (u64)height > MAX_CELLS) {
+        fprintf(stderr, "usage: server [addr] [scene|world.snap|-] [width height]\n");
+        return 1;
+    }
+
+    Grid grid = new_grid((i32)width, (i32)height, 1);
+    if (!grid.len) {
+        fprintf(stderr, "server: cannot allocate %ld x %ld cells\n", width, height);
+        free_grid(&grid);
+        return 1;
+    }
+    const Scene *scene = NULL;
+    if (is_snapshot(from)) {
+        if (!load_snapshot(&grid, from)) {
+            fprintf(stderr, "server: cannot load %s\n", from);
+            free_grid(&grid);
+            return 1;
+        }
+    } else if (strcmp(from, "-") != 0) {
+        if (!(scene = find_scene(from))) {
+            fprintf(stderr, "server: no scene named %s\n", from);
+            free_grid(&grid);
+            return 1;
+        }
+        scene->init(&grid);
+    }
+
+    const i32 listener = stream_listen(addr);
+    if (listener < 0) {
+        fprintf(stderr, "server: cannot listen on %s\n", addr);
+        free_grid(&grid);
+        return 1;
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    // a viewer going away shows up as a failed send, not a signal
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("server: %u x %u cells on %s\n", grid.width, grid.len / grid.width, addr);
+
+    Scheduler sched = new_scheduler();
+    Stream viewer = { .fd = -1 };
+    Sent sent;
+    new_sent(&sent, &grid);
+
+    u32 t = 0;
+    f64 last = now_sec(), stats = last;
+    u32 frames = 0;
+    u64 bytes = 0;
+    // a keyframe is owed, kept until one is queued since the viewer can still be
+    //   busy with the last frame, the deltas after a reset mean nothing without it
+    bool key = false;
+    while (!quit) {
+        if (viewer.fd < 0 && stream_accept(listener, &viewer)) {
+            printf("server: viewer connected\n");
+            key = true;
+        }
+        if (viewer.fd >= 0) {
+            if (!stream_pump(&viewer)) {
+                printf("server: viewer left\n");
+                bytes += viewer.sent;
+                stream_close(&viewer);
+            } else if (read_input(&viewer, &grid)) {
+                t = 0;
+                free_sent(&sent);
+                new_sent(&sent, &grid);
+                key = true;
+            }
+        }
+
+        const f64 now = now_sec();
+        const u32 ticks = due_ticks(&sched, now - last, grid.tps);
+        last = now;
+        mark_sent(&sent, &grid);
+        for (u32 i = 0; i < ticks; ++i, ++t) {
+            if (scene) scene->tick(&grid, t);
+            update_gravity(&grid);
+            mark_sent(&sent, &grid);
+        }
+
+        // a viewer still taking the last frame gets the changes of both in the next
+        if (viewer.fd >= 0 && (ticks || key) && !stream_busy(&viewer)) {
+            if (key || grid.tick - sent.key_tick >= STREAM_KEY_EVERY) {
+                stream_key(&viewer, &sent, &grid);
+                key = false;
+            } else {
+                stream_delta(&viewer, &sent, &grid);
+            }
+            frames++;
+            // a viewer that left is noticed on the next pump
+            stream_pump(&viewer);
+        }
+
+        if (now - stats >= STATS_EVERY) {
+            const u64 total = bytes + (viewer.fd >= 0 ? viewer.sent : 0);
+            printf("tick %llu, %u ticks/sec, %u frames, %.1f KiB/s, %.0f bytes/frame\n",
+                (unsigned long long)grid.tick, sched.rate, frames, (f64)total / 1024.0 / (now - stats),
+                frames ? (f64)total / frames : 0.0);
+            bytes = 0;
+            if (viewer.fd >= 0) viewer.sent = 0;
+            frames = 0;
+            stats = now;
+        }
+        // wakes up for the next tick, and often enough to pick up input
+        const f64 step = grid.tps ? 1.0 / grid.tps : 0.01;
+        const f64 wait = step - sched.acc;
+        sleep_sec(wait > 0.004 ? 0.004 : wait > 0 ? wait : 0);
+    }
+
+    stream_close(&viewer);
+    close(listener);
+    if (strchr(addr, '/')) remove(addr);
+    free_sent(&sent);
+    free_scheduler(&sched);
+    free_grid(&grid);
+    return 0;
+}
@@ -0,0 +1,696 @@
+#include <stdlib.h>
+#include <string.h>
+#ifdef CAND_DEBUG
+#include <stdio.h>
+#endif
+#include "sim.h"
+#include "simd.h"
+#include "blocks.h"
+
+// false when something didn't fit in memory
+static bool alloc_step_state(Grid *grid) {
+    grid->dir   = calloc(grid->len, sizeof(u8));
+    grid->pow   = calloc(grid->len, sizeof(u16));
+    grid->moved = calloc((grid->len + 63) / 64, sizeof(u64));
+    const bool gas = alloc_gas(&grid->gas, grid->width, grid->len / grid->width);
+
+    // every chunk starts awake, so whatever is in the grid gets stepped at least once
+    const u32 height = grid->len / grid->width;
+    grid->chunks.width = (grid->width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    grid->chunks.len   = grid->chunks.width * ((height + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    grid->chunks.awake = calloc(grid->chunks.len, sizeof(u8));
+    grid->chunks.next  = malloc(grid->chunks.len * sizeof(u8));
+    if (!gas || !grid->dir || !grid->pow || !grid->moved || !grid->chunks.awake || !grid->chunks.next) return false;
+    memset(grid->chunks.next, 1, grid->chunks.len);
+    return true;
+}
+
+static void free_step_state(Grid *grid) {
+    free(grid->chunks.awake);
+    free(grid->chunks.next);
+    free_gas(&grid->gas);
+    free(grid->moved);
+    free(grid->pow);
+    free(grid->dir);
+    grid->chunks.awake = grid->chunks.next = NULL;
+    grid->gas   = (Gas){0};
+    grid->moved = NULL;
+    grid->pow   = NULL;
+    grid->dir   = NULL;
+}
+
+Grid new_grid(const i32 px_width, const i32 px_height, const i32 ppb) {
+    Grid grid = {
+        .buff_pbb = ppb,
+        .px_width = px_width,
+        .px_height = px_height,
+        .tps = TPS,
+        .selected_type = SOLID_WHITE,
+        .dbg = {
+            .on = false,
+            .draw = true
+        },
+        .brush = {
+            .radius = 1,
+            .buff = 1,
+            .hovered = -1,
+            .last = -1,
+        },
+        .seed = SEED,
+        .cores = MAX_THREADS,
+        .buff_cores = MAX_THREADS,
+    };
+    // sized like any reset, so a size that doesn't fit leaves it without cells too
+    reset_data(&grid);
+    return grid;
+}
+
+void free_grid(const Grid *grid) {
+    free_pool(grid->pool);
+    free(grid->chunks.awake);
+    free(grid->chunks.next);
+    free_gas(&grid->gas);
+    free(grid->moved);
+    free(grid->pow);
+    free(grid->dir);
+    free(grid->data);
+}
+
+bool reset_data(Grid *grid) {
+    free(grid->data);
+    free_step_state(grid);
+    // 0 when it is out of range, the grid then gets no cells
+    const i32 pbb    = grid->buff_pbb >= 1.f && grid->buff_pbb <= (f32)MAX_PBB ? (i32)(grid->buff_pbb + 0.5f) : 0;
+    const i32 width  = pbb ? grid->px_width  / pbb : 0;
+    const i32 height = pbb ? grid->px_height / pbb : 0;
+    const i64 len = (i64)width * height;
+    if (grid->rec && pbb) record_reset(grid->rec, pbb);
+    grid->pbb   = pbb ? pbb : 1;
+    grid->num   = 0;
+    memset(grid->pop, 0, sizeof(grid->pop));
+    grid->brush.last = -1;
+    grid->tick  = 0;
+    if (width > 0 && height > 0 && len <= UINT32_MAX) {
+        grid->data  = calloc((size_t)len, sizeof(u8));
+        grid->len   = (u32)len;
+        grid->width = (u32)width;
+        if (grid->data && alloc_step_state(grid)) return true;
+        free(grid->data);
+        free_step_state(grid);
+    }
+
+    // a grid without cells, nothing may be stepped or painted until the next reset
+    grid->data  = NULL;
+    grid->len   = 0;
+    grid->width = 1;
+    grid->chunks.width = 1;
+    grid->chunks.len   = 0;
+    return false;
+}
+
+inline void flop(u8 *lhs, u8 *rhs) {
+    const u8 tmp = *lhs;
+    *lhs = *rhs;
+    *rhs = tmp;
+}
+
+static inline bool moved(const Grid *grid, const u32 i) {
+    return grid->moved[i >> 6] >> (i & 63) & 1;
+}
+
+static inline void set_moved(const Grid *grid, const u32 i) {
+    grid->moved[i >> 6] |= (u64)1 << (i & 63);
+}
+
+static inline void clear_moved(const Grid *grid, const u32 i) {
+    grid->moved[i >> 6] &= ~((u64)1 << (i & 63));
+}
+
+// counts every cell again, false when Grid.pop or Grid.num is off, so a write
+//   that lost or made a cell shows up as soon as it happens
+bool check_pop(const Grid *grid) {
+    u32 pop[MATERIALS_LEN] = {0};
+    u32 num = 0;
+    for (u32 i = 0; i < grid->len; ++i) {
+        if (!grid->data[i]) continue; // no sand
+        pop[grid->data[i]]++;
+        num++;
+    }
+    return num == grid->num && memcmp(pop, grid->pop, sizeof(pop)) == 0;
+}
+
+// marks the chunk of the cell to be stepped next tick, along with any chunk
+//   holding a neighbour of the cell, as those may react to the change
+static void wake_xy(const Grid *grid, const i32 x, const i32 y) {
+    const u32 cw = grid->chunks.width;
+    const u32 ch = grid->chunks.len / cw;
+    const u32 cx = x / CHUNK_SIZE;
+    const u32 cy = y / CHUNK_SIZE;
+
+    const u32 x0 = (x % CHUNK_SIZE == 0 && cx > 0) ? cx - 1 : cx;
+    const u32 x1 = (x % CHUNK_SIZE == CHUNK_SIZE - 1 && cx < cw - 1) ? cx + 1 : cx;
+    const u32 y0 = (y % CHUNK_SIZE == 0 && cy > 0) ? cy - 1 : cy;
+    const u32 y1 = (y % CHUNK_SIZE == CHUNK_SIZE - 1 && cy < ch - 1) ? cy + 1 : cy;
+
+    u8 *next = grid->chunks.next;
+    for (u32 ny = y0; ny <= y1; ++ny) {
+        for (u32 nx = x0; nx <= x1; ++nx) next[nx + ny * cw] = 1;
+    }
+}
+
+void wake_cell(const Grid *grid, const u32 i) {
+    wake_xy(grid, i % grid->width, i / grid->width);
+}
+
+bool place_cell(Grid *grid, const u32 i, const u8 type) {
+    if (i >= grid->len || grid->data[i] || type == EMPTY || type >= MATERIALS_LEN) return false;
+    if (flags_of(type) & GAS) {
+        add_gas(&grid->gas, i % grid->width, i / grid->width, GAS_PUFF);
+        return true;
+    }
+    grid->data[i] = type;
+    grid->dir[i]  = 0;
+    grid->pow[i]  = 0;
+    grid->num++;
+    grid->pop[type]++;
+    wake_cell(grid, i);
+    return true;
+}
+
+// dx, dy are the offset from the centre of the brush
+bool in_brush(const Grid *grid, const i32 dx, const i32 dy) {
+    const i32 r = grid->brush.radius ? (i32)grid->brush.radius - 1 : 0;
+    if (dx < -r || dx > r || dy < -r || dy > r) return false;
+    if (grid->brush.shape == BRUSH_CIRCLE) return dx * dx + dy * dy <= r * r + r;
+    return true;
+}
+
+// stamps the brush centred on index, only visiting the cells it covers
+static u32 stamp(Grid *grid, const i32 index, const u8 type) {
+    if (index < 0 || (u32)index >= grid->len) return 0;
+    const i32 height = grid->len / grid->width;
+    const i32 r  = grid->brush.radius ? (i32)grid->brush.radius - 1 : 0;
+    const i32 cx = index % grid->width;
+    const i32 cy = index / grid->width;
+
+    const i32 x0 = cx - r > 0 ? cx - r : 0;
+    const i32 y0 = cy - r > 0 ? cy - r : 0;
+    const i32 x1 = cx + r < (i32)grid->width - 1 ? cx + r : (i32)grid->width - 1;
+    const i32 y1 = cy + r < height - 1 ? cy + r : height - 1;
+
+    u32 num = 0;
+    for (i32 y = y0; y <= y1; ++y) {
+        for (i32 x = x0; x <= x1; ++x) {
+            if (!in_brush(grid, x - cx, y - cy)) continue;
+            num += place_cell(grid, x + y * grid->width, type);
+        }
+    }
+    return num;
+}
+
+u32 paint(Grid *grid, const i32 index, const u8 type) {
+    return paint_stroke(grid, -1, index, type);
+}
+
+// stamps the brush along the line between two indexes, so a fast drag leaves no gaps
+u32 paint_stroke(Grid *grid, const i32 from, const i32 to, const u8 type) {
+    if (grid->rec) record_stroke(grid->rec, from, to, type, grid->brush.radius, grid->brush.shape);
+    if (from < 0 || (u32)from >= grid->len) return stamp(grid, to, type);
+    const i32 x0 = from % grid->width, y0 = from / grid->width;
+    const i32 x1 = to   % grid->width, y1 = to   / grid->width;
+    const i32 dx = x1 - x0, dy = y1 - y0;
+    const i32 steps = abs(dx) > abs(dy) ? abs(dx) : abs(dy);
+
+    // stamps overlap as long as they are no more than a radius apart
+    const i32 r = grid->brush.radius > 1 ? (i32)grid->brush.radius - 1 : 1;
+
+    u32 num = 0;
+    for (i32 s = steps % r; s <= steps; s += r) {
+        const i32 x = steps ? x0 + dx * s / steps : x0;
+        const i32 y = steps ? y0 + dy * s / steps : y0;
+        num += stamp(grid, x + y * grid->width, type);
+    }
+    return num;
+}
+
+// x, y are in cells with y = 0 being the floor, only fills empty cells
+u32 fill_rect(Grid *grid, const u32 x, const u32 y, u32 w, u32 h, const u8 type) {
+    if (grid->rec) record_fill(grid->rec, x, y, w, h, type);
+    const u32 height = grid->len / grid->width;
+    if (x >= grid->width || y >= height) return 0;
+    if (x + w > grid->width) w = grid->width - x;
+    if (y + h > height)      h = height - y;
+
+    u32 num = 0;
+    for (u32 iy = y; iy < y + h; ++iy) {
+        for (u32 ix = x; ix < x + w; ++ix) {
+            num += place_cell(grid, ix + iy * grid->width, type);
+        }
+    }
+    return num;
+}
+
+// FNV-1a over the cells, for checking two runs ended up the same
+u64 hash_grid(const Grid *grid) {
+    u64 hash = 0xcbf29ce484222325ull;
+    for (u32 i = 0; i < grid->len; ++i) {
+        hash = (hash ^ grid->data[i]) * 0x100000001b3ull;
+    }
+    // an empty field hashes to nothing, so runs without gas hash the same as before it
+    if (grid->gas.live) {
+        const u32 len = gas_stride(&grid->gas) * (grid->gas.h + 2);
+        for (u32 i = 0; i < len; ++i) hash = (hash ^ grid->gas.d[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// a solid sinks through anything lighter than it
+static inline bool sinks_into(const u8 cell, const u8 under) {
+    return (flags_of(cell) & SOLID) && MATERIALS[cell].density > MATERIALS[under].density;
+}
+
+// moves the cell at i to target, its momentum is replaced by dir and pow
+static inline void move_cell(const Grid *grid, const i32 i, const i32 target, const u8 dir, const u16 pow) {
+    grid->data[target] = grid->data[i];
+    grid->dir[target]  = dir;
+    grid->pow[target]  = pow;
+    set_moved(grid, target);
+    grid->data[i] = 0;
+    grid->dir[i]  = 0;
+    grid->pow[i]  = 0;
+}
+
+// cells in the row beside i that are free in the direction dx, up to max
+static inline u32 free_beside(const Grid *grid, const i32 i, const i32 x, const i32 dx, const u32 max) {
+    u32 n = 0;
+    while (n < max) {
+        const i32 nx = x + dx * (i32)(n + 1);
+        if (nx < 0 || nx >= (i32)grid->width || grid->data[i + dx * (i32)(n + 1)]) break;
+        n++;
+    }
+    return n;
+}
+
+// Liquids are moved along their row, through the body they are part of:
+/*
+    Key:
+        0 => empty
+        1 => sand
+        W => liquid
+        S => liquid under sand (start)
+        F => where it ends up  (finish)
+
+    route_liquid, sand sinking into W W S W 0 pushes the liquid to the closest
+    empty cell past the run of liquid it is in, as if the run shifted over by one
+
+    1 1 1 1 1 1 1 1        1 1 1 1 1 1 1 1
+    W W W S W W 0 1   =>   W W W 1 W W F 1
+
+    find_drop, a resting liquid looks along the empty cells of its row for the
+    closest one with room below it, and moves straight into that, or FLOW_REACH
+    cells towards it when it is further
+
+    W 0 0 0 0 1            0 0 0 0 0 1
+    W W W W 0 1   =>       W W W W F 1
+*/
+// returns the index the liquid at i was moved to, -1 when there is no room in reach
+static i32 route_liquid(const Grid *grid, const i32 i, const i32 x, Rng *rng) {
+    const u8 cell = grid->data[i];
+    const i32 first = rng_dir(rng);
+    bool open[2] = { true, true };
+    for (i32 k = 1; k <= FLOW_REACH && (open[0] || open[1]); ++k) {
+        for (u32 side = 0; side < 2; ++side) {
+            if (!open[side]) continue;
+            const i32 dx = side ? -first : first;
+            const i32 nx = x + dx * k;
+            if (nx < 0 || nx >= (i32)grid->width) { open[side] = false; continue; }
+            const i32 n = i + dx * k;
+            const u8 other = grid->data[n];
+            if (other == cell) continue;
+            if (other) { open[side] = false; continue; }
+
+            grid->data[n] = cell;
+            grid->dir[n]  = 0;
+            grid->pow[n]  = 0;
+            set_moved(grid, n);
+            grid->data[i] = 0;
+            wake_cell(grid, n);
+            return n;
+        }
+    }
+    return -1;
+}
+
+// columns away of the closest cell in the row with room below it, negative for
+//   the left, 0 when the empty cells either side of i have none in FLOW_SCAN
+static i32 find_drop(const Grid *grid, const i32 i, const i32 x, const i32 y, Rng *rng) {
+    if (y == 0) return 0;
+    const i32 w = (i32)grid->width;
+    // most liquid is boxed in by more liquid, that needs no roll
+    const bool left  = x > 0     && !grid->data[i - 1];
+    const bool right = x < w - 1 && !grid->data[i + 1];
+    if (!left && !right) return 0;
+    const i32 first = left && right ? rng_dir(rng) : (left ? -1 : 1);
+    bool open[2] = { true, left && right };
+    for (i32 k = 1; k <= FLOW_SCAN && (open[0] || open[1]); ++k) {
+        for (u32 side = 0; side < 2; ++side) {
+            if (!open[side]) continue;
+            const i32 dx = side ? -first : first;
+            const i32 nx = x + dx * k;
+            if (nx < 0 || nx >= w || grid->data[i + dx * k]) { open[side] = false; continue; }
+            if (!grid->data[i + dx * k - w]) return dx * k;
+        }
+    }
+    return 0;
+}
+
+// a liquid leaving x, y opens a drop for row y + 1 and a path along row y, the
+//   resting liquids that find_drop would see it from are woken, however far.
+//   The scan stops at an empty cell with room below, anything past it already
+//   had that drop to flow to
+static void wake_flow(const Grid *grid, const i32 x, const i32 y) {
+    const i32 w = (i32)grid->width;
+    const i32 height = (i32)(grid->len / grid->width);
+    for (i32 ry = y; ry <= y + 1 && ry < height; ++ry) {
+        const u8 *row = &grid->data[ry * w];
+        for (i32 dx = -1; dx <= 1; dx += 2) {
+            for (i32 k = 1; k <= FLOW_SCAN; ++k) {
+                const i32 nx = x + dx * k;
+                if (nx < 0 || nx >= w) break;
+                if (!row[nx]) {
+                    if (ry > 0 && !row[nx - w]) break;
+                    continue;
+                }
+                // only the liquid itself has to look again, not its neighbours
+                if (flags_of(row[nx]) & LIQUID) grid->chunks.next[nx / CHUNK_SIZE + ry / CHUNK_SIZE * grid->chunks.width] = 1;
+                break;
+            }
+        }
+    }
+}
+
+// what one strip of the step keeps to itself, so strips stepped at the same time
+//   share nothing
+typedef struct Strip {
+    Rng rng;
+    StepCounts counts;
+} Strip;
+
+// the cell at i has nothing below it, the longer it has been falling the more
+//   cells it covers. flags are the cell's
+static inline void fall_cell(const Grid *grid, const i32 i, const i32 x, const i32 y, const u8 flags) {
+    const i32 w = (i32)grid->width;
+    const u16 pow = grid->pow[i];
+    u32 max = 1 + pow / POW_SCALE;
+    // never past the strip under it, whatever pow it was loaded with
+    if (max > MAX_FALL) max = MAX_FALL;
+    if (max > (u32)y) max = y;
+    u32 fall = 1;
+    while (fall < max && !grid->data[i - (i32)(fall + 1) * w]) fall++;
+    // mid fall the cell it leaves was empty a tick ago, so nothing new opens
+    const bool opens = (flags & LIQUID) && grid->dir[i] != DIR_S;
+    move_cell(grid, i, i - (i32)fall * w, DIR_S, pow + GRAVITY < MAX_POW ? pow + GRAVITY : MAX_POW);
+    wake_xy(grid, x, y - (i32)fall);
+    wake_xy(grid, x, y);
+    if (opens) wake_flow(grid, x, y);
+}
+
+// The step of a cell that hasn't moved yet. It is inlined once per material
+//   with that material's flags (see STEPS), so every test on them is constant
+//   and each material only carries the branches it can take.
+// x, y are the coordinates of i, to save dividing them back out when waking chunks
+static inline __attribute__((always_inline)) void step_cell(const Grid *grid, const i32 i, const i32 x, const i32 y,
+    Strip *strip, const u8 flags) {
+    if (!flags || (flags & (STILL | GAS))) return;
+    Rng *rng = &strip->rng;
+    const u8 cell = grid->data[i];
+    const i32 w = (i32)grid->width;
+
+    // sinking through liquid drops any momentum of both cells
+    if ((flags & LIQUID) && i + w < (i32)grid->len && sinks_into(grid->data[i + w], cell)) {
+        const i32 above = i + w;
+        const i32 mov = route_liquid(grid, i, x, rng);
+        if (mov >= 0 ) {
+            strip->counts.displaced++;
+            grid->data[i] = grid->data[above];
+            set_moved(grid, i);
+            grid->data[above] = 0;
+        } else {
+            strip->counts.blocked++;
+            // the moved state goes with the cells
+            flop(&grid->data[i], &grid->data[above]);
+            if (moved(grid, above)) set_moved(grid, i);
+            clear_moved(grid, above);
+        }
+        grid->dir[i] = 0; grid->pow[i] = 0;
+        grid->dir[above] = 0; grid->pow[above] = 0;
+        wake_xy(grid, x, y);
+        wake_xy(grid, x, y + 1);
+        return;
+    }
+
+    // free fall
+    if (y > 0 && !grid->data[i - w]) {
+        fall_cell(grid, i, x, y, flags);
+        return;
+    }
+
+    // floating under a heavier liquid, the two swap and it rises a cell a tick
+    if ((flags & FLOAT) && i + w < (i32)grid->len) {
+        const i32 above = i + w;
+        const u8 liquid = grid->data[above];
+        if ((flags_of(liquid) & LIQUID) && MATERIALS[liquid].density > MATERIALS[cell].density) {
+            flop(&grid->data[i], &grid->data[above]);
+            set_moved(grid, i);
+            set_moved(grid, above);
+            grid->dir[i] = 0; grid->pow[i] = 0;
+            grid->dir[above] = 0; grid->pow[above] = 0;
+            wake_xy(grid, x, y);
+            wake_xy(grid, x, y + 1);
+            return;
+        }
+    }
+
+    const u16 pow = grid->pow[i];
+
+    // sliding down a slope keeps half the speed
+    if (y > 0) {
+        const i32 below_i = i - w;
+        // the sides of the grid are walls, rows don't wrap into the next
+        const u8 before = x > 0     ? grid->data[below_i - 1] : STILL_GREY;
+        const u8 after  = x < w - 1 ? grid->data[below_i + 1] : STILL_GREY;
+        i32 dx = 0;
+        if (!before && !after) dx = rng_dir(rng); // Before & After
+        else if (!before)      dx = -1;           // After
+        else if (!after)       dx = 1;            // Before
+        if (dx) {
+            move_cell(grid, i, below_i + dx, dx < 0 ? DIR_SW : DIR_SE, pow / 2);
+            wake_xy(grid, x + dx, y - 1);
+            wake_xy(grid, x, y);
+            if (flags & LIQUID) wake_flow(grid, x, y);
+            return;
+        }
+    }
+
+    // resting, nothing to spend
+    if (!pow && !(flags & LIQUID)) return;
+
+    // landed, what is left of the fall is turned sideways
+    u8 dir = grid->dir[i];
+    u16 left = pow;
+    if (dir & (DIR_S | DIR_SW | DIR_SE)) {
+        if      (dir == DIR_SW) dir = DIR_W;
+        else if (dir == DIR_SE) dir = DIR_E;
+        else                    dir = rng_dir(rng) < 0 ? DIR_W : DIR_E;
+        left = pow / SPLASH;
+    }
+
+    i32 dx = dir == DIR_W ? -1 : 1;
+    u32 n = 0;
+    if (left >= POW_SCALE && (dir & (DIR_E | DIR_W))) {
+        u32 max = left / POW_SCALE;
+        if (max > MAX_FALL) max = MAX_FALL;
+        n = free_beside(grid, i, x, dx, max);
+        left = n ? left - (u16)(n * POW_SCALE) : 0;
+    }
+    if (!n && (flags & LIQUID)) {
+        // flows to the closest drop, a level pool has none and goes to sleep
+        const i32 drop = find_drop(grid, i, x, y, rng);
+        if (drop >= -FLOW_REACH && drop <= FLOW_REACH && drop) {
+            move_cell(grid, i, i + drop - w, 0, 0);
+            wake_xy(grid, x + drop, y - 1);
+            wake_xy(grid, x, y);
+            wake_flow(grid, x, y);
+            return;
+        }
+        if (drop) {
+            dx = drop < 0 ? -1 : 1;
+            n = FLOW_REACH;
+        }
+        left = 0;
+    }
+
+    if (!n) {
+        if (pow) {
+            grid->dir[i] = 0;
+            grid->pow[i] = 0;
+        }
+        return;
+    }
+    move_cell(grid, i, i + dx * (i32)n, left ? (dx < 0 ? DIR_W : DIR_E) : 0, left);
+    wake_xy(grid, x + dx * (i32)n, y);
+    wake_xy(grid, x, y);
+    if (flags & LIQUID) wake_flow(grid, x, y);
+}
+
+typedef void (*StepFn)(const Grid *grid, i32 i, i32 x, i32 y, Strip *strip);
+
+#define STEP_KERNEL(id, name, flags, ...)                                                       \
+    static void step_##id(const Grid *grid, const i32 i, const i32 x, const i32 y, Strip *strip) { \
+        step_cell(grid, i, x, y, strip, flags);                                                 \
+    }
+MATERIAL_LIST(STEP_KERNEL)
+#undef STEP_KERNEL
+
+// the step of each material, indexed by the cell
+#define STEP_ENTRY(id, ...) [id] = step_##id,
+static const StepFn STEPS[MATERIALS_LEN] = {
+    MATERIAL_LIST(STEP_ENTRY)
+};
+#undef STEP_ENTRY
+
+static inline void update_cell(const Grid *grid, const i32 i, const i32 x, const i32 y, Strip *strip) {
+    const u8 cell = grid->data[i];
+    if (!cell) return; // no sand
+    if (moved(grid, i)) return;
+    STEPS[cell](grid, i, x, y, strip);
+}
+
+#ifdef SIMD_LANES
+// moved bits of the CHUNK_SIZE cells from i
+static inline u32 moved_run(const Grid *grid, const u32 i) {
+    const u32 shift = i & 63;
+    u64 bits = grid->moved[i >> 6] >> shift;
+    if (shift > 64 - CHUNK_SIZE) bits |= grid->moved[(i >> 6) + 1] << (64 - shift);
+    return (u32)bits & ((1u << CHUNK_SIZE) - 1);
+}
+
+// steps the chunk wide run of cells from i like update_cell would one by one,
+//   cells that just fall skip the branches and resting ones aren't visited.
+//   Rows y - 1 and y + 1 have to exist, the masks read both
+static inline void update_run(const Grid *grid, const u32 i, const u32 x0, const u32 y, Strip *strip) {
+    const u32 w = grid->width;
+    u32 busy;
+    u32 fall = cell_masks(&grid->data[i], &grid->data[i - w], &grid->data[i + w], &grid->pow[i],
+        x0 == 0, x0 + CHUNK_SIZE == w, &busy);
+    const u32 skip = moved_run(grid, i);
+    fall &= ~skip;
+    busy &= ~skip;
+
+    // cells to the left can only fill the row below, so a cell that falls is
+    //   checked once more, while the resting ones stay resting
+    for (u32 todo = fall | busy; todo; todo &= todo - 1) {
+        const u32 n = (u32)__builtin_ctz(todo);
+        const i32 c = (i32)(i + n);
+        if ((fall >> n & 1) && !grid->data[c - (i32)w]) fall_cell(grid, c, (i32)(x0 + n), (i32)y, flags_of(grid->data[c]));
+        else update_cell(grid, c, (i32)(x0 + n), (i32)y, strip);
+    }
+}
+#endif
+
+// steps the rows in [from, to), bottom to top, skipping chunks that are asleep
+static void update_gravity_rows(const Grid *grid, const u32 from, const u32 to, Strip *strip) {
+    const u32 cw = grid->chunks.width;
+#ifdef SIMD_LANES
+    const u32 height = grid->len / grid->width;
+#endif
+    for (u32 y = from; y < to; ++y) {
+        const u8 *awake = &grid->chunks.awake[(y / CHUNK_SIZE) * cw];
+        const u32 row = y * grid->width;
+        for (u32 cx = 0; cx < cw; ++cx) {
+            if (!awake[cx]) continue;
+            const u32 x0 = cx * CHUNK_SIZE;
+            const u32 x1 = x0 + CHUNK_SIZE < grid->width ? x0 + CHUNK_SIZE : grid->width;
+            strip->counts.visited += x1 - x0;
+#ifdef SIMD_LANES
+            if (x1 - x0 == CHUNK_SIZE && y >= 2 && y + 1 < height) {
+                update_run(grid, row + x0, x0, y, strip);
+                continue;
+            }
+#endif
+            for (u32 x = x0; x < x1; ++x) update_cell(grid, (i32)(row + x), x, y, strip);
+        }
+    }
+}
+
+typedef struct Strips {
+    const Grid *grid;
+    u32 len;    // number of strips
+    u32 phase;  // 0 => even strips, 1 => odd strips
+    StepCounts counts[MAX_STRIPS];
+} Strips;
+
+static void update_gravity_strip(void *arg, const u32 job) {
+    Strips *strips = arg;
+    const Grid *grid = strips->grid;
+    const u32 height = grid->len / grid->width;
+    const u32 rows = grid->chunks.len / grid->chunks.width;
+    const u32 s = job * 2 + strips->phase;
+
+    // strips start and end on chunk rows, so two workers never wake the same chunk
+    const u32 from = s * rows / strips->len * CHUNK_SIZE;
+    const u32 to   = (s + 1) * rows / strips->len * CHUNK_SIZE;
+    Strip strip = { .rng = new_rng(grid->seed, grid->tick * MAX_STRIPS + s) };
+    update_gravity_rows(grid, from, to < height ? to : height, &strip);
+    strips->counts[s] = strip.counts;
+}
+
+// The grid is cut into horizontal strips, the even ones are stepped in parallel,
+//   then the odd ones. A strip only writes a few rows past its edges, so while
+//   its neighbours are idle no two workers can touch the same cell.
+// The strips don't depend on grid->cores and each has its own rng stream, so
+//   the same seed and input step the same at any core count.
+void update_gravity(Grid *grid) {
+    u8 *awake = grid->chunks.awake;
+    grid->chunks.awake = grid->chunks.next;
+    grid->chunks.next  = awake;
+    memset(grid->chunks.next, 0, grid->chunks.len);
+    memset(grid->moved, 0, (grid->len + 63) / 64 * sizeof(u64));
+
+    const u32 rows = grid->chunks.len / grid->chunks.width;
+    u32 len = MAX_STRIPS;
+    if (len > rows / (MIN_STRIP / CHUNK_SIZE)) len = rows / (MIN_STRIP / CHUNK_SIZE);
+    if (len < 1) len = 1;
+
+    // the threads are only started once the grid is stepped on more than one
+    if (!grid->pool && grid->cores > 1 && len > 1) grid->pool = new_pool(MAX_THREADS - 1);
+
+    StepCounts *counts = &grid->counts;
+    if (grid->engine == ENGINE_BLOCKS) {
+        update_blocks(grid, len);
+    } else {
+        Strips strips = { .grid = grid, .len = len };
+        for (strips.phase = 0; strips.phase < 2; ++strips.phase) {
+            const u32 jobs = (len - strips.phase + 1) / 2;
+            pool_run(grid->pool, update_gravity_strip, &strips, jobs, grid->cores);
+        }
+        for (u32 s = 0; s < len; ++s) {
+            counts->visited   += strips.counts[s].visited;
+            counts->displaced += strips.counts[s].displaced;
+            counts->blocked   += strips.counts[s].blocked;
+        }
+    }
+    update_gas(&grid->gas, grid->data, grid->width, grid->len / grid->width);
+
+    // every cell that moved is marked, however it got there
+    for (u32 k = 0; k < (grid->len + 63) / 64; ++k) counts->moved += (u32)__builtin_popcountll(grid->moved[k]);
+    grid->tick++;
+    if (grid->rec) record_tick(grid->rec, grid->engine);
+#ifdef CAND_DEBUG
+    // the step only ever moves cells, it never adds or removes one
+    if (grid->tick % POP_CHECK_EVERY == 0 && !check_pop(grid)) {
+        fprintf(stderr, "cand: cell counts drifted by tick %llu\n", (unsigned long long)grid->tick);
+        abort();
+    }
+#endif
+}
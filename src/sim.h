@@ -0,0 +1,158 @@
+#ifndef CAND_SIM_H
+#define CAND_SIM_H
+#include <stdbool.h>
+#include "types.h"
+#include "pool.h"
+#include "rng.h"
+#include "record.h"
+#include "material.h"
+#include "gas.h"
+
+// Headless simulation core, must not depend on raylib so it can be stepped
+// without a window (see bench.c)
+
+static const f32 TPS = 60.f;
+static const u32 MAX_THREADS = 6;
+static const u64 SEED = 0x63616e64; // "cand"
+// cells per side of a chunk, chunks where nothing moved are skipped by the step
+//   until something in or next to them changes
+#define CHUNK_SIZE 16
+// rows per strip in the parallel step, has to stay well above how far a cell
+//   can fall in a tick (MAX_FALL), so strips stepped at the same time never touch
+//   (not even the same u64 of Grid.moved), and be a multiple of CHUNK_SIZE
+#define MIN_STRIP (CHUNK_SIZE * 2)
+// strips the step is cut into when the grid is tall enough, two per thread
+#define MAX_STRIPS 12
+// the most cells a grid sized from outside input (a file, a job, the command
+//   line) may have, so a bad size can't ask for more than fits in memory or a u32
+#define MAX_CELLS (1u << 28)
+// the largest pixels per bit a grid can be sized with, the gui goes to 100 and a
+//   float holds it exactly
+#define MAX_PBB   (1u << 16)
+// with CAND_DEBUG the step checks Grid.pop against a full count this often
+#define POP_CHECK_EVERY 64
+
+typedef enum BrushShape {
+    BRUSH_SQUARE,
+    BRUSH_CIRCLE,
+} BrushShape;
+
+typedef enum StepEngine {
+    ENGINE_GRAVITY, // the cell by cell sweep of sim.c
+    ENGINE_BLOCKS,  // 2x2 blocks through a lookup table, see blocks.h
+    ENGINES_LEN,
+} StepEngine;
+
+// what the step did, summed over ticks until the caller clears Grid.counts
+typedef struct StepCounts {
+    u32 visited;    // cells in the chunks that were awake
+    u32 moved;      // cells that ended a tick somewhere new
+    u32 displaced;  // liquids pushed along their row by a solid sinking into them
+    u32 blocked;    // the same with no room in reach, the two swap instead
+} StepCounts;
+
+typedef struct Grid {
+    u8  *data;      // material ids, see material.h
+    u8  *dir;       // momentum of the cells, see Momentum below
+    u16 *pow;
+    u64 *moved;     // bitset of the cells moved into this tick, they are not stepped again
+    Gas gas;        // smoke, stepped after the cells
+    i32 pbb;
+    f32 buff_pbb;
+    u32 width;
+    u32 len;
+    u32 px_width;  // size of the world in screen pixels, width = px_width / pbb
+    u32 px_height;
+    u32 tps;
+    u64 seed;       // with the same input, the same seed always steps the same
+    u64 tick;       // ticks since the last reset
+    u32 num;        // cells in the grid, the sum of pop
+    u32 pop[MATERIALS_LEN]; // cells of each material, kept by every write that adds or removes one
+    StepCounts counts;
+    i32 engine;     // StepEngine, i32 so the gui can point at it
+    struct {
+        bool on;
+        bool draw;
+    } dbg;
+    u8 selected_type;
+    struct {
+        u32 radius;   // 1 => a single cell
+        f32 buff;
+        i32 shape;    // BrushShape, i32 so the gui can point at it
+        i32 hovered;  // index under the mouse, -1 when off the grid
+        i32 last;     // where the stroke was last frame, -1 when not painting
+    } brush;
+    struct {
+        u8 *awake;  // chunks stepped this tick
+        u8 *next;   // chunks woken for the next tick
+        u32 width;
+        u32 len;
+    } chunks;
+    u32 cores;
+    f32 buff_cores;
+    Pool *pool;     // NULL until the first step with cores > 1
+    Recorder *rec;  // when set, input and ticks are logged to it
+    struct {
+        f32 x, y;
+    } pos;
+    bool line;
+    bool tap;
+    bool man_step;
+    bool i_on_hov;
+} Grid;
+
+
+// Momentum of a cell (the Px idea), kept next to Grid.data as its own arrays so the step only
+//   reads the bytes it needs (a resting cell never touches dir)
+/*
+    dir  u8   | NW N NE E SE S SW W |  where the cell is headed
+    pow  u16  how fast, in 1 / POW_SCALE cells per tick on top of the first cell
+    a falling cell gains GRAVITY pow every tick, up to MAX_FALL cells a tick,
+    on landing the pow is turned sideways so it slides, then spent cell by cell
+*/
+#define DIR_W   0b00000001
+#define DIR_SW  0b00000010
+#define DIR_S   0b00000100
+#define DIR_SE  0b00001000
+#define DIR_E   0b00010000
+#define DIR_NE  0b00100000
+#define DIR_N   0b01000000
+#define DIR_NW  0b10000000
+
+#define POW_SCALE 4
+#define GRAVITY   1
+// has to stay well below MIN_STRIP, a cell can't land past the strip under its own
+#define MAX_FALL  (CHUNK_SIZE / 2)
+#define MAX_POW   ((MAX_FALL - 1) * POW_SCALE)
+// how much of the pow is kept as sideways slide on landing, 1 / SPLASH
+#define SPLASH    2
+// furthest a liquid flows along its row in a tick, liquids only ever move within
+//   their row or into the one below so this isn't bound by the strips
+#define FLOW_REACH CHUNK_SIZE
+// furthest a resting liquid looks along its row for somewhere lower to flow to
+#define FLOW_SCAN  (CHUNK_SIZE * 4)
+
+// momentum the step could have given a cell, no direction or one and at most
+//   MAX_POW, for checking what is read back from a file
+static inline bool valid_momentum(const u64 dir, const u64 pow) {
+    return dir <= DIR_NW && (dir & (dir - 1)) == 0 && pow <= MAX_POW;
+}
+
+
+// len is 0 when the size doesn't fit in memory, as after a failed reset_data
+Grid new_grid(i32 px_width, i32 px_height, i32 ppb);
+void free_grid(const Grid *grid);
+// false when the new size doesn't fit in memory, the grid is then left without cells
+bool reset_data(Grid *grid);
+void update_gravity(Grid *grid);
+bool check_pop(const Grid *grid);
+void wake_cell(const Grid *grid, u32 i);
+bool place_cell(Grid *grid, u32 i, u8 type);
+bool in_brush(const Grid *grid, i32 dx, i32 dy);
+u32 paint(Grid *grid, i32 index, u8 type);
+u32 paint_stroke(Grid *grid, i32 from, i32 to, u8 type);
+u32 fill_rect(Grid *grid, u32 x, u32 y, u32 w, u32 h, u8 type);
+u64 hash_grid(const Grid *grid);
+void flop(u8 *lhs, u8 *rhs);
+
+#endif //CAND_SIM_H
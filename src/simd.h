@@ -0,0 +1,141 @@
+#ifndef CAND_SIMD_H
+#define CAND_SIMD_H
+#include <stdbool.h>
+#include "types.h"
+#include "material.h"
+
+// Sorts a chunk wide run of cells into the ones that just fall, the ones that
+// need the full step and the ones that can be skipped, a whole run at a time
+// as the u8 cells of a run fit one 16 byte vector. The properties of a vector
+// of cells are looked up with a byte shuffle of MATERIAL_FLAGS (ssse3, wasm)
+// or one compare per material (sse2). Picked at compile time, build with
+// -mssse3 (or anything above it) or -msimd128 for the shuffle and
+// -DCAND_NO_SIMD to step every cell through update_cell
+/*
+    live = cell && !STILL
+    sink = LIQUID cell under a SOLID one, or FLOAT cell under a LIQUID one
+    fall = live && below is empty && !sink
+    rest = !LIQUID && !sink && below, below - 1 and below + 1 are taken && pow == 0
+    busy = live && !fall && !rest
+*/
+// sink leaves density out, a lane it takes from fall is only stepped in full
+
+#if defined(CAND_NO_SIMD)
+#define SIMD_NAME "scalar"
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define SIMD_NAME "ssse3"
+#define SIMD_LANES 16
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_NAME "sse2"
+#define SIMD_LANES 16
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SIMD_NAME "wasm simd128"
+#define SIMD_LANES 16
+#else
+#define SIMD_NAME "scalar"
+#endif
+
+#ifdef SIMD_LANES
+_Static_assert(CHUNK_SIZE == SIMD_LANES, "a chunk wide run is one vector of cells");
+
+// c is the run, b and a the same columns a row below and above, returns the
+//   fall bits and sets busy, bit n is c[n]. wall_l and wall_r are set when the
+//   run starts or ends at a side of the grid, the cell read past it is a wall
+//   then. Only for sim.c, it uses its flags
+#if defined(__SSE2__) || defined(_M_X64)
+
+static inline __m128i flags_of_x16(const __m128i cells) {
+#if defined(__SSSE3__)
+    return _mm_shuffle_epi8(_mm_load_si128((const __m128i *)MATERIAL_FLAGS), cells);
+#else
+    __m128i flags = _mm_setzero_si128();
+    for (u8 m = 1; m < MATERIALS_LEN; ++m) {
+        const __m128i is = _mm_cmpeq_epi8(cells, _mm_set1_epi8((char)m));
+        flags = _mm_or_si128(flags, _mm_and_si128(is, _mm_set1_epi8((char)MATERIAL_FLAGS[m])));
+    }
+    return flags;
+#endif
+}
+
+static inline u32 cell_masks(const u8 *c, const u8 *b, const u8 *a, const u16 *pow,
+    const bool wall_l, const bool wall_r, u32 *busy) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vc  = _mm_loadu_si128((const __m128i *)c);
+    const __m128i vb  = _mm_loadu_si128((const __m128i *)b);
+    const __m128i vbl = _mm_or_si128(_mm_loadu_si128((const __m128i *)(b - 1)),
+                                     _mm_cvtsi32_si128(wall_l ? STILL_GREY : 0));
+    const __m128i vbr = _mm_or_si128(_mm_loadu_si128((const __m128i *)(b + 1)),
+                                     _mm_slli_si128(_mm_cvtsi32_si128(wall_r ? STILL_GREY : 0), 15));
+    const __m128i fc  = flags_of_x16(vc);
+    const __m128i fa  = flags_of_x16(_mm_loadu_si128((const __m128i *)a));
+    const __m128i p0  = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)pow), zero);
+    const __m128i p1  = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(pow + 8)), zero);
+
+    const __m128i empty     = _mm_cmpeq_epi8(vc, zero);
+    const __m128i not_still = _mm_cmpeq_epi8(_mm_and_si128(fc, _mm_set1_epi8(STILL)), zero);
+    const __m128i not_liq   = _mm_cmpeq_epi8(_mm_and_si128(fc, _mm_set1_epi8(LIQUID)), zero);
+    const __m128i not_solid = _mm_cmpeq_epi8(_mm_and_si128(fa, _mm_set1_epi8(SOLID)), zero);
+    const __m128i not_float = _mm_cmpeq_epi8(_mm_and_si128(fc, _mm_set1_epi8(FLOAT)), zero);
+    const __m128i not_wet   = _mm_cmpeq_epi8(_mm_and_si128(fa, _mm_set1_epi8(LIQUID)), zero);
+    const __m128i b_empty   = _mm_cmpeq_epi8(vb, zero);
+    const __m128i side      = _mm_or_si128(_mm_cmpeq_epi8(vbl, zero), _mm_cmpeq_epi8(vbr, zero));
+    const __m128i no_pow    = _mm_packs_epi16(p0, p1);
+
+    const __m128i live = _mm_andnot_si128(empty, not_still);
+    const __m128i sink = _mm_or_si128(_mm_andnot_si128(not_liq, _mm_andnot_si128(not_solid, live)),
+                                      _mm_andnot_si128(not_float, _mm_andnot_si128(not_wet, live)));
+    const __m128i fall = _mm_andnot_si128(sink, _mm_and_si128(live, b_empty));
+    const __m128i rest = _mm_andnot_si128(sink,
+        _mm_and_si128(_mm_andnot_si128(_mm_or_si128(b_empty, side), not_liq), no_pow));
+
+    *busy = (u32)_mm_movemask_epi8(_mm_andnot_si128(_mm_or_si128(fall, rest), live));
+    return (u32)_mm_movemask_epi8(fall);
+}
+
+#elif defined(__wasm_simd128__)
+
+// wasm_v128_andnot(a, b) is a & ~b, the other way round from sse
+static inline u32 cell_masks(const u8 *c, const u8 *b, const u8 *a, const u16 *pow,
+    const bool wall_l, const bool wall_r, u32 *busy) {
+    const v128_t zero  = wasm_i8x16_splat(0);
+    const v128_t table = wasm_v128_load(MATERIAL_FLAGS);
+    const v128_t vc  = wasm_v128_load(c);
+    const v128_t vb  = wasm_v128_load(b);
+    v128_t vbl = wasm_v128_load(b - 1);
+    v128_t vbr = wasm_v128_load(b + 1);
+    if (wall_l) vbl = wasm_i8x16_replace_lane(vbl, 0, STILL_GREY);
+    if (wall_r) vbr = wasm_i8x16_replace_lane(vbr, 15, STILL_GREY);
+    const v128_t fc  = wasm_i8x16_swizzle(table, vc);
+    const v128_t fa  = wasm_i8x16_swizzle(table, wasm_v128_load(a));
+    const v128_t p0  = wasm_i16x8_eq(wasm_v128_load(pow), zero);
+    const v128_t p1  = wasm_i16x8_eq(wasm_v128_load(pow + 8), zero);
+
+    const v128_t empty     = wasm_i8x16_eq(vc, zero);
+    const v128_t not_still = wasm_i8x16_eq(wasm_v128_and(fc, wasm_i8x16_splat(STILL)), zero);
+    const v128_t not_liq   = wasm_i8x16_eq(wasm_v128_and(fc, wasm_i8x16_splat(LIQUID)), zero);
+    const v128_t not_solid = wasm_i8x16_eq(wasm_v128_and(fa, wasm_i8x16_splat(SOLID)), zero);
+    const v128_t not_float = wasm_i8x16_eq(wasm_v128_and(fc, wasm_i8x16_splat(FLOAT)), zero);
+    const v128_t not_wet   = wasm_i8x16_eq(wasm_v128_and(fa, wasm_i8x16_splat(LIQUID)), zero);
+    const v128_t b_empty   = wasm_i8x16_eq(vb, zero);
+    const v128_t side      = wasm_v128_or(wasm_i8x16_eq(vbl, zero), wasm_i8x16_eq(vbr, zero));
+    const v128_t no_pow    = wasm_i8x16_narrow_i16x8(p0, p1);
+
+    const v128_t live = wasm_v128_andnot(not_still, empty);
+    const v128_t sink = wasm_v128_or(wasm_v128_andnot(wasm_v128_andnot(live, not_solid), not_liq),
+                                     wasm_v128_andnot(wasm_v128_andnot(live, not_wet), not_float));
+    const v128_t fall = wasm_v128_andnot(wasm_v128_and(live, b_empty), sink);
+    const v128_t rest = wasm_v128_andnot(
+        wasm_v128_and(wasm_v128_andnot(not_liq, wasm_v128_or(b_empty, side)), no_pow), sink);
+
+    *busy = (u32)wasm_i8x16_bitmask(wasm_v128_andnot(live, wasm_v128_or(fall, rest)));
+    return (u32)wasm_i8x16_bitmask(fall);
+}
+
+#endif
+
+#endif //SIMD_LANES
+
+#endif //CAND_SIMD_H
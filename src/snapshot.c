@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "snapshot.h"
+#include "sim.h"
+
+#define HEADER_SIZE (4 + 4 * 6 + 8 * 2)
+
+static u8 *put_varint(u8 *p, u64 v) {
+    while (v >= 0x80) {
+        *p++ = (u8)(v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    *p++ = (u8)v;
+    return p;
+}
+
+static const u8 *get_varint(const u8 *p, const u8 *end, u64 *v) {
+    *v = 0;
+    for (u32 shift = 0; shift < 64 && p < end; shift += 7) {
+        const u8 c = *p++;
+        *v |= (u64)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return p;
+    }
+    return NULL;
+}
+
+static u8 *put_u32(u8 *p, const u32 v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+    return p + 4;
+}
+
+static u32 get_u32(const u8 *p) {
+    return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+}
+
+bool save_snapshot(const Grid *grid, const char *path) {
+    const u32 height = grid->len / grid->width;
+    const Gas *gas = &grid->gas;
+    // worst case every cell is its own run, of a count, a cell, a dir and a pow,
+    //   and every block of gas one of a count and a density
+    u8 *buf = malloc(HEADER_SIZE + (size_t)grid->len * 11 + (size_t)gas->w * gas->h * 8 +
+        grid->chunks.len / 8 + 1);
+    if (!buf) return false;
+    u8 *p = buf;
+
+    memcpy(p, "CSNP", 4); p += 4;
+    p = put_u32(p, SNAP_VERSION);
+    p = put_u32(p, grid->px_width);
+    p = put_u32(p, grid->px_height);
+    p = put_u32(p, (u32)grid->pbb);
+    p = put_u32(p, grid->width);
+    p = put_u32(p, height);
+    p = put_u32(p, (u32)grid->seed); p = put_u32(p, (u32)(grid->seed >> 32));
+    p = put_u32(p, (u32)grid->tick); p = put_u32(p, (u32)(grid->tick >> 32));
+
+    for (u32 y = 0; y < height; ++y) {
+        const u8 *row = grid->data + y * grid->width;
+        for (u32 x = 0; x < grid->width;) {
+            const u32 i = y * grid->width + x;
+            u32 run = 1;
+            while (x + run < grid->width && row[x + run] == row[x] &&
+                grid->dir[i + run] == grid->dir[i] && grid->pow[i + run] == grid->pow[i]) run++;
+            p = put_varint(p, run);
+            p = put_varint(p, row[x]);
+            p = put_varint(p, grid->dir[i]);
+            p = put_varint(p, grid->pow[i]);
+            x += run;
+        }
+    }
+    const u32 blocks = gas->w * gas->h;
+    for (u32 b = 0; b < blocks;) {
+        const u16 d = gas->d[gas_index(gas, b)];
+        u32 run = 1;
+        while (b + run < blocks && gas->d[gas_index(gas, b + run)] == d) run++;
+        p = put_varint(p, run);
+        p = put_varint(p, d);
+        b += run;
+    }
+
+    // without the chunks due to be stepped, a loaded world would step differently
+    //   from the one that was saved
+    memset(p, 0, grid->chunks.len / 8 + 1);
+    for (u32 c = 0; c < grid->chunks.len; ++c) {
+        if (grid->chunks.next[c]) p[c / 8] |= (u8)(1 << (c % 8));
+    }
+    p += grid->chunks.len / 8 + 1;
+
+    FILE *file = fopen(path, "wb");
+    const size_t size = (size_t)(p - buf);
+    const bool ok = file && fwrite(buf, 1, size, file) == size;
+    if (file) fclose(file);
+    free(buf);
+    return ok;
+}
+
+static bool decode_rows(Grid *grid, const u8 *p, const u8 *end) {
+    const u8 *awake = end - (grid->chunks.len / 8 + 1);
+    if (awake < p) return false;
+    end = awake;
+
+    const u32 height = grid->len / grid->width;
+    for (u32 y = 0; y < height; ++y) {
+        const u32 row = y * grid->width;
+        for (u32 x = 0; x < grid->width;) {
+            u64 run, cell, dir, pow;
+            if (!(p = get_varint(p, end, &run)) || !(p = get_varint(p, end, &cell))) return false;
+            if (!(p = get_varint(p, end, &dir)) || !(p = get_varint(p, end, &pow))) return false;
+            if (!run || run > grid->width - x) return false;
+            if (cell >= MATERIALS_LEN || (flags_of((u8)cell) & GAS)) return false;
+            if (!valid_momentum(dir, pow)) return false;
+            if (cell) {
+                for (u32 i = row + x; i < row + x + run; ++i) {
+                    grid->data[i] = (u8)cell;
+                    grid->dir[i]  = (u8)dir;
+                    grid->pow[i]  = (u16)pow;
+                }
+                grid->num += (u32)run;
+                grid->pop[cell] += (u32)run;
+            }
+            x += (u32)run;
+        }
+    }
+
+    Gas *gas = &grid->gas;
+    const u32 blocks = gas->w * gas->h;
+    for (u32 b = 0; b < blocks;) {
+        u64 run, d;
+        if (!(p = get_varint(p, end, &run)) || !(p = get_varint(p, end, &d))) return false;
+        if (!run || run > blocks - b || d > GAS_MAX) return false;
+        for (u32 k = b; k < b + run; ++k) gas->d[gas_index(gas, k)] = (u16)d;
+        gas->live |= d != 0;
+        b += (u32)run;
+    }
+
+    if (p != end) return false;
+    for (u32 c = 0; c < grid->chunks.len; ++c) {
+        grid->chunks.next[c] = (awake[c / 8] >> (c % 8)) & 1;
+    }
+    return true;
+}
+
+static bool decode(Grid *grid, const u8 *p, const size_t size) {
+    if (size < HEADER_SIZE || memcmp(p, "CSNP", 4) != 0) return false;
+    if (get_u32(p + 4) != SNAP_VERSION) return false;
+    const u32 px_width  = get_u32(p + 8);
+    const u32 px_height = get_u32(p + 12);
+    const u32 pbb       = get_u32(p + 16);
+    const u32 width     = get_u32(p + 20);
+    const u32 height    = get_u32(p + 24);
+    if (!pbb || pbb > MAX_PBB || px_width / pbb != width || px_height / pbb != height) return false;
+    if (!width || !height || (u64)width * height > MAX_CELLS) return false;
+
+    stop_recording(grid);
+    const u32 old_width  = grid->px_width;
+    const u32 old_height = grid->px_height;
+    const f32 old_pbb    = grid->buff_pbb;
+    grid->px_width  = px_width;
+    grid->px_height = px_height;
+    grid->buff_pbb  = (f32)pbb;
+    if (!reset_data(grid)) {
+        // too big for memory, back to an empty grid of the old size
+        grid->px_width  = old_width;
+        grid->px_height = old_height;
+        grid->buff_pbb  = old_pbb;
+        reset_data(grid);
+        return false;
+    }
+    grid->seed = (u64)get_u32(p + 32) << 32 | get_u32(p + 28);
+    grid->tick = (u64)get_u32(p + 40) << 32 | get_u32(p + 36);
+
+    if (decode_rows(grid, p + HEADER_SIZE, p + size)) return true;
+
+    // a truncated file leaves an empty grid of the size the header asked for
+    memset(grid->data, 0, grid->len * sizeof(u8));
+    memset(grid->dir, 0, grid->len * sizeof(u8));
+    memset(grid->pow, 0, grid->len * sizeof(u16));
+    grid->num = 0;
+    memset(grid->pop, 0, sizeof(grid->pop));
+    clear_gas(&grid->gas);
+    return false;
+}
+
+bool load_snapshot(Grid *grid, const char *path) {
+#ifdef _WIN32
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    u8 *buf = size > 0 ? malloc((size_t)size) : NULL;
+    const bool read = buf && fread(buf, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+    const bool ok = read && decode(grid, buf, (size_t)size);
+    free(buf);
+#else
+    const i32 fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    const size_t size = (size_t)st.st_size;
+    const u8 *buf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED) return false;
+    const bool ok = decode(grid, buf, size);
+    munmap((void *)buf, size);
+#endif
+    return ok;
+}
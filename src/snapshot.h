@@ -0,0 +1,28 @@
+#ifndef CAND_SNAPSHOT_H
+#define CAND_SNAPSHOT_H
+#include <stdbool.h>
+#include "types.h"
+
+// Saved cells of a grid, also used as the starting world for bench
+/*
+    header: "CSNP" u32 version, u32 px_width, u32 px_height, u32 pbb,
+            u32 width, u32 height, u64 seed, u64 tick
+    then every row from the floor up as runs, all varints:
+        count, cell, dir, pow   count cells of the same material id and momentum,
+                                never past the row
+    then the gas field (see gas.h) block rows from the floor up, without the border,
+    as runs across rows, all varints:
+        count, density
+    then chunks.len / 8 + 1 bytes, a bit per chunk set when the next tick steps it
+*/
+
+#define SNAP_VERSION 4
+
+struct Grid;
+
+bool save_snapshot(const struct Grid *grid, const char *path);
+// resizes the grid to the snapshot, stops any recording since the log can't
+//   reproduce the loaded cells
+bool load_snapshot(struct Grid *grid, const char *path);
+
+#endif //CAND_SNAPSHOT_H
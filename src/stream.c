@@ -0,0 +1,481 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "stream.h"
+#include "sim.h"
+
+// how much a read from the socket takes at most
+#define READ_BYTES (64 * 1024)
+
+// a failed buf takes nothing more, so a message is never sent with a hole in it
+static bool reserve(Buf *buf, const size_t more) {
+    if (buf->failed) return false;
+    if (buf->len + more <= buf->cap) return true;
+    size_t cap = buf->cap ? buf->cap : 4096;
+    while (cap < buf->len + more) cap *= 2;
+    u8 *d = realloc(buf->d, cap);
+    if (!d) {
+        buf->failed = true;
+        return false;
+    }
+    buf->d   = d;
+    buf->cap = cap;
+    return true;
+}
+
+static void put_varint(Buf *buf, u64 v) {
+    if (!reserve(buf, 10)) return;
+    while (v >= 0x80) {
+        buf->d[buf->len++] = (u8)(v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    buf->d[buf->len++] = (u8)v;
+}
+
+static bool get_varint(const u8 **p, const u8 *end, u64 *v) {
+    *v = 0;
+    for (u32 shift = 0; shift < 64 && *p < end; shift += 7) {
+        const u8 c = *(*p)++;
+        *v |= (u64)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+// the length is filled in by end_msg, returns where it goes
+static size_t begin_msg(Buf *buf, const u8 op) {
+    const size_t at = buf->len;
+    if (!reserve(buf, 5)) return at;
+    buf->len += 4;
+    buf->d[buf->len++] = op;
+    return at;
+}
+
+// a message that didn't fit is dropped whole, stream_pump then ends the stream
+//   since the other end would be out of step without it
+static void end_msg(Buf *buf, const size_t at) {
+    if (buf->failed) {
+        buf->len = at;
+        return;
+    }
+    const u32 len = (u32)(buf->len - at - 4);
+    const u8 b[4] = { len, len >> 8, len >> 16, len >> 24 };
+    memcpy(&buf->d[at], b, sizeof(b));
+}
+
+// --- sockets
+
+static void set_nonblocking(const i32 fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+// fills un when addr is a path, otherwise resolves host:port into res
+static bool resolve(const char *addr, struct sockaddr_un *un, struct addrinfo **res, const bool passive) {
+    if (strchr(addr, '/')) {
+        if (strlen(addr) >= sizeof(un->sun_path)) return false;
+        *un = (struct sockaddr_un){ .sun_family = AF_UNIX };
+        strcpy(un->sun_path, addr);
+        *res = NULL;
+        return true;
+    }
+    char host[256];
+    const char *colon = strrchr(addr, ':');
+    if (!colon || (size_t)(colon - addr) >= sizeof(host)) return false;
+    memcpy(host, addr, colon - addr);
+    host[colon - addr] = '\0';
+
+    const struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+        .ai_flags = passive ? AI_PASSIVE : 0,
+    };
+    return getaddrinfo(host[0] ? host : NULL, colon + 1, &hints, res) == 0;
+}
+
+i32 stream_listen(const char *addr) {
+    struct sockaddr_un un;
+    struct addrinfo *res;
+    if (!resolve(addr, &un, &res, true)) return -1;
+
+    i32 fd = -1;
+    if (!res) {
+        unlink(un.sun_path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && bind(fd, (struct sockaddr *)&un, sizeof(un)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        for (const struct addrinfo *a = res; a && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) continue;
+            const i32 on = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            if (bind(fd, a->ai_addr, a->ai_addrlen) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(res);
+    }
+    if (fd < 0) return -1;
+    if (listen(fd, 1) != 0) {
+        close(fd);
+        return -1;
+    }
+    set_nonblocking(fd);
+    return fd;
+}
+
+static void open_stream(Stream *stream, const i32 fd) {
+    *stream = (Stream){ .fd = fd };
+    // frames are small and one at a time, they shouldn't wait to fill a packet
+    const i32 on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    set_nonblocking(fd);
+}
+
+bool stream_accept(const i32 listener, Stream *stream) {
+    const i32 fd = accept(listener, NULL, NULL);
+    if (fd < 0) return false;
+    open_stream(stream, fd);
+    return true;
+}
+
+bool stream_connect(Stream *stream, const char *addr) {
+    stream->fd = -1;
+    struct sockaddr_un un;
+    struct addrinfo *res;
+    if (!resolve(addr, &un, &res, false)) return false;
+
+    i32 fd = -1;
+    if (!res) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, (struct sockaddr *)&un, sizeof(un)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        for (const struct addrinfo *a = res; a && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(res);
+    }
+    if (fd < 0) return false;
+    open_stream(stream, fd);
+    return true;
+}
+
+void stream_close(Stream *stream) {
+    if (stream->fd >= 0) close(stream->fd);
+    free(stream->in.d);
+    free(stream->out.d);
+    *stream = (Stream){ .fd = -1 };
+}
+
+bool stream_pump(Stream *stream) {
+    if (stream->fd < 0 || stream->out.failed) return false;
+    Buf *out = &stream->out;
+    while (out->at < out->len) {
+        const ssize_t n = send(stream->fd, &out->d[out->at], out->len - out->at, 0);
+        if (n > 0) {
+            out->at += (size_t)n;
+            stream->sent += (u64)n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            break;
+        } else {
+            return false;
+        }
+    }
+    if (out->at == out->len) out->at = out->len = 0;
+
+    // what was already handed out by stream_next is dropped
+    Buf *in = &stream->in;
+    if (in->at) {
+        memmove(in->d, &in->d[in->at], in->len - in->at);
+        in->len -= in->at;
+        in->at = 0;
+    }
+    for (;;) {
+        if (!reserve(in, READ_BYTES)) return false;
+        const ssize_t n = recv(stream->fd, &in->d[in->len], READ_BYTES, 0);
+        if (n > 0) {
+            in->len += (size_t)n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+}
+
+u8 stream_next(Stream *stream, const u8 **body, size_t *len) {
+    Buf *in = &stream->in;
+    while (in->len - in->at >= 4) {
+        const u8 *p = &in->d[in->at];
+        const u32 n = (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+        if (in->len - in->at - 4 < n) return 0;
+        in->at += 4 + (size_t)n;
+        if (!n) continue;
+        *body = p + 5;
+        *len  = n - 1;
+        return p[4];
+    }
+    return 0;
+}
+
+bool stream_args(const u8 *body, const size_t len, u64 *args, const u32 n) {
+    const u8 *end = body + len;
+    for (u32 i = 0; i < n; ++i) {
+        if (!get_varint(&body, end, &args[i])) return false;
+    }
+    return true;
+}
+
+void stream_stroke(Stream *stream, const i32 from, const i32 to, const u8 type, const u32 radius, const i32 shape) {
+    const size_t at = begin_msg(&stream->out, STREAM_STROKE);
+    put_varint(&stream->out, (u64)(from + 1)); // -1 => no previous stamp
+    put_varint(&stream->out, (u64)to);
+    put_varint(&stream->out, type);
+    put_varint(&stream->out, radius);
+    put_varint(&stream->out, (u64)shape);
+    end_msg(&stream->out, at);
+}
+
+void stream_reset(Stream *stream) {
+    end_msg(&stream->out, begin_msg(&stream->out, STREAM_RESET));
+}
+
+// --- server side
+
+void new_sent(Sent *sent, const Grid *grid) {
+    *sent = (Sent){
+        .len    = grid->len,
+        .blocks = grid->gas.w * grid->gas.h,
+        .cells  = calloc(grid->len, sizeof(u8)),
+        .dirty  = calloc(grid->chunks.len, sizeof(u8)),
+    };
+    sent->gas = calloc(sent->blocks, sizeof(u16));
+}
+
+void free_sent(const Sent *sent) {
+    free(sent->dirty);
+    free(sent->gas);
+    free(sent->cells);
+}
+
+// a cell only changes by a write that wakes its chunk, or by the step of an awake
+//   chunk, so between frames the rest can't differ from what was sent
+void mark_sent(Sent *sent, const Grid *grid) {
+    for (u32 c = 0; c < grid->chunks.len; ++c) sent->dirty[c] |= grid->chunks.awake[c] | grid->chunks.next[c];
+}
+
+void stream_key(Stream *stream, Sent *sent, const Grid *grid) {
+    Buf *out = &stream->out;
+    const size_t at = begin_msg(out, STREAM_KEY);
+    put_varint(out, grid->tick);
+    put_varint(out, grid->width);
+    put_varint(out, grid->len / grid->width);
+    for (u32 i = 0; i < grid->len;) {
+        u32 n = 1;
+        while (i + n < grid->len && grid->data[i + n] == grid->data[i]) n++;
+        put_varint(out, n);
+        put_varint(out, grid->data[i]);
+        i += n;
+    }
+    for (u32 b = 0; b < sent->blocks;) {
+        const u16 d = grid->gas.d[gas_index(&grid->gas, b)];
+        u32 n = 1;
+        while (b + n < sent->blocks && grid->gas.d[gas_index(&grid->gas, b + n)] == d) n++;
+        put_varint(out, n);
+        put_varint(out, d);
+        for (u32 k = 0; k < n; ++k) sent->gas[b + k] = d;
+        b += n;
+    }
+    end_msg(out, at);
+
+    memcpy(sent->cells, grid->data, grid->len * sizeof(u8));
+    memset(sent->dirty, 0, grid->chunks.len);
+    sent->any_gas  = grid->gas.live;
+    sent->key_tick = grid->tick;
+}
+
+// the changed cells of chunk c, returns false when there are none
+static bool put_chunk(Buf *out, Sent *sent, const Grid *grid, const u32 c, const u32 gap) {
+    const u32 height = grid->len / grid->width;
+    const u32 x0 = c % grid->chunks.width * CHUNK_SIZE;
+    const u32 y0 = c / grid->chunks.width * CHUNK_SIZE;
+    const u32 cols = grid->width - x0 < CHUNK_SIZE ? grid->width - x0 : CHUNK_SIZE;
+    const u32 rows = height - y0 < CHUNK_SIZE ? height - y0 : CHUNK_SIZE;
+
+    u32 row_mask = 0;
+    for (u32 r = 0; r < rows; ++r) {
+        const u32 i = (y0 + r) * grid->width + x0;
+        if (memcmp(&grid->data[i], &sent->cells[i], cols) != 0) row_mask |= 1u << r;
+    }
+    if (!row_mask) return false;
+
+    put_varint(out, gap);
+    put_varint(out, row_mask);
+    for (u32 r = 0; r < rows; ++r) {
+        if (!(row_mask & 1u << r)) continue;
+        const u32 i = (y0 + r) * grid->width + x0;
+        u32 col_mask = 0;
+        for (u32 x = 0; x < cols; ++x) col_mask |= (u32)(grid->data[i + x] != sent->cells[i + x]) << x;
+        put_varint(out, col_mask);
+        for (u32 x = 0; x < cols; ++x) {
+            if (col_mask & 1u << x) put_varint(out, grid->data[i + x]);
+        }
+        memcpy(&sent->cells[i], &grid->data[i], cols);
+    }
+    return true;
+}
+
+void stream_delta(Stream *stream, Sent *sent, const Grid *grid) {
+    Buf *out = &stream->out;
+    const size_t at = begin_msg(out, STREAM_DELTA);
+    put_varint(out, grid->tick);
+
+    i64 last = -1;
+    for (u32 c = 0; c < grid->chunks.len; ++c) {
+        if (!sent->dirty[c]) continue;
+        sent->dirty[c] = 0;
+        if (put_chunk(out, sent, grid, c, (u32)(c - last))) last = c;
+    }
+    put_varint(out, 0);
+
+    // the field is small next to the cells, it is compared whole while there is gas
+    if (grid->gas.live || sent->any_gas) {
+        u32 skip = 0;
+        for (u32 b = 0; b < sent->blocks;) {
+            u32 n = 0;
+            while (b + n < sent->blocks && grid->gas.d[gas_index(&grid->gas, b + n)] != sent->gas[b + n]) n++;
+            if (!n) {
+                skip++;
+                b++;
+                continue;
+            }
+            put_varint(out, skip);
+            put_varint(out, n);
+            for (u32 k = 0; k < n; ++k, ++b) {
+                sent->gas[b] = grid->gas.d[gas_index(&grid->gas, b)];
+                put_varint(out, sent->gas[b]);
+            }
+            skip = 0;
+        }
+        sent->any_gas = grid->gas.live;
+    }
+    put_varint(out, 0);
+    put_varint(out, 0);
+    end_msg(out, at);
+}
+
+// --- viewer side
+
+void free_view(const View *view) {
+    if (!view->cells) return;
+    free_gas(&view->gas);
+    free(view->cells);
+}
+
+static bool apply_key(View *view, const u8 *p, const u8 *end) {
+    u64 tick, width, height;
+    if (!get_varint(&p, end, &tick) || !get_varint(&p, end, &width) || !get_varint(&p, end, &height)) return false;
+    // each side first, so the product can't wrap
+    if (!width || !height || width > STREAM_MAX_SIDE || height > STREAM_MAX_SIDE) return false;
+    if (width * height > STREAM_MAX_CELLS) return false;
+
+    if (!view->cells || view->width != width || view->height != height) {
+        free_view(view);
+        view->width  = (u32)width;
+        view->height = (u32)height;
+        view->cells  = calloc(width * height, sizeof(u8));
+        if (!alloc_gas(&view->gas, view->width, view->height) || !view->cells) {
+            free_gas(&view->gas);
+            free(view->cells);
+            *view = (View){0};
+            return false;
+        }
+    }
+    view->tick = tick;
+
+    const u32 len = view->width * view->height;
+    u64 n, v;
+    for (u32 i = 0; i < len; i += (u32)n) {
+        if (!get_varint(&p, end, &n) || !get_varint(&p, end, &v)) return false;
+        if (!n || n > len - i || v >= MATERIALS_LEN) return false;
+        memset(&view->cells[i], (u8)v, n);
+    }
+    const u32 blocks = view->gas.w * view->gas.h;
+    for (u32 b = 0; b < blocks; b += (u32)n) {
+        if (!get_varint(&p, end, &n) || !get_varint(&p, end, &v)) return false;
+        if (!n || n > blocks - b) return false;
+        for (u32 k = b; k < b + n; ++k) view->gas.d[gas_index(&view->gas, k)] = (u16)v;
+    }
+    return true;
+}
+
+static bool apply_delta(View *view, const u8 *p, const u8 *end) {
+    if (!view->cells) return false;
+    u64 tick;
+    if (!get_varint(&p, end, &tick)) return false;
+    view->tick = tick;
+
+    const u32 cw = (view->width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const u32 chunks = cw * ((view->height + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    u64 c = (u64)-1, gap, row_mask, col_mask, v;
+    for (;;) {
+        if (!get_varint(&p, end, &gap)) return false;
+        if (!gap) break;
+        c += gap;
+        if (c >= chunks || !get_varint(&p, end, &row_mask)) return false;
+
+        const u32 x0 = (u32)(c % cw) * CHUNK_SIZE;
+        const u32 y0 = (u32)(c / cw) * CHUNK_SIZE;
+        const u32 cols = view->width - x0 < CHUNK_SIZE ? view->width - x0 : CHUNK_SIZE;
+        const u32 rows = view->height - y0 < CHUNK_SIZE ? view->height - y0 : CHUNK_SIZE;
+        if (row_mask >> rows) return false;
+        for (u32 r = 0; r < rows; ++r) {
+            if (!(row_mask & 1u << r)) continue;
+            if (!get_varint(&p, end, &col_mask) || col_mask >> cols) return false;
+            u8 *row = &view->cells[(y0 + r) * view->width + x0];
+            for (u32 x = 0; x < cols; ++x) {
+                if (!(col_mask & 1u << x)) continue;
+                if (!get_varint(&p, end, &v) || v >= MATERIALS_LEN) return false;
+                row[x] = (u8)v;
+            }
+        }
+    }
+
+    const u32 blocks = view->gas.w * view->gas.h;
+    u64 skip, n;
+    for (u32 b = 0;;) {
+        if (!get_varint(&p, end, &skip) || !get_varint(&p, end, &n)) return false;
+        if (!n) break;
+        if (skip > blocks - b || n > blocks - b - skip) return false;
+        b += (u32)skip;
+        for (u32 k = 0; k < n; ++k, ++b) {
+            if (!get_varint(&p, end, &v)) return false;
+            view->gas.d[gas_index(&view->gas, b)] = (u16)v;
+        }
+    }
+    return true;
+}
+
+bool apply_frame(View *view, const u8 op, const u8 *body, const size_t len) {
+    if (op == STREAM_KEY)   return apply_key(view, body, body + len);
+    if (op == STREAM_DELTA) return apply_delta(view, body, body + len);
+    return false;
+}
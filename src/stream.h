@@ -0,0 +1,117 @@
+#ifndef CAND_STREAM_H
+#define CAND_STREAM_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+#include "gas.h"
+
+// A grid stepped in one process (server.c) and drawn in another (viewer.c),
+// over a TCP or unix socket. The viewer is sent a keyframe of every cell, then
+// only the chunks that could have changed since the last frame, compared to a
+// copy of what it was sent, so a settled grid costs a few bytes a frame
+/*
+    every message: u32 length of the rest, u8 type, then varints
+    server -> viewer
+        STREAM_KEY     tick, width, height, then the cells from the floor up as runs
+                       (count, id), then the gas blocks without the border as runs
+                       (count, density)
+        STREAM_DELTA   tick, then every changed chunk:
+                           index - previous index (the first counts from -1),
+                           a mask of its changed rows, per changed row a mask of its
+                           changed cells, then their ids
+                       0, then the changed gas blocks as runs:
+                           skip, count (> 0), count densities
+                       skip, 0
+    viewer -> server
+        STREAM_STROKE  from + 1, to, type, radius, shape   as REC_STROKE
+        STREAM_RESET
+*/
+
+// ticks between keyframes, the viewer is also sent one on connecting and resets
+#define STREAM_KEY_EVERY 600
+// the default address of server and viewer, a path is a unix socket
+#define STREAM_ADDR "127.0.0.1:7878"
+// largest side of a keyframe the viewer takes, and most cells
+#define STREAM_MAX_SIDE  (1u << 16)
+#define STREAM_MAX_CELLS (1u << 28)
+
+typedef enum StreamOp {
+    STREAM_KEY = 1,
+    STREAM_DELTA,
+    STREAM_STROKE,
+    STREAM_RESET,
+} StreamOp;
+
+typedef struct Buf {
+    u8 *d;
+    size_t len;
+    size_t cap;
+    size_t at;      // read or sent up to here
+    bool failed;    // it couldn't grow, a message was lost and the stream is done
+} Buf;
+
+// one end of a connection, it never blocks
+typedef struct Stream {
+    i32 fd;         // -1 when closed
+    Buf in;         // received, the rest of a message not here yet
+    Buf out;        // queued, not all sent yet
+    u64 sent;       // bytes sent over the connection
+} Stream;
+
+// what the viewer has been sent, kept by the server
+typedef struct Sent {
+    u8  *cells;
+    u16 *gas;       // the gas blocks without the border
+    u8  *dirty;     // a byte per chunk, set when it could differ from cells
+    u32 len;
+    u32 blocks;
+    bool any_gas;   // gas holds some
+    u64 key_tick;   // tick of the last keyframe
+} Sent;
+
+struct Grid;
+
+// the viewer's side, only the cells and gas of a grid
+typedef struct View {
+    u8 *cells;
+    Gas gas;
+    u32 width;
+    u32 height;
+    u64 tick;
+} View;
+
+// -1 when it can't, addr is host:port, :port or a path for a unix socket
+i32 stream_listen(const char *addr);
+// a waiting connection, false when there is none
+bool stream_accept(i32 listener, Stream *stream);
+bool stream_connect(Stream *stream, const char *addr);
+void stream_close(Stream *stream);
+
+// sends what the socket takes of out and reads what has arrived into in, false
+//   once the other end is gone, or a message couldn't be queued
+bool stream_pump(Stream *stream);
+// true while out still holds some of an earlier message
+static inline bool stream_busy(const Stream *stream) {
+    return stream->out.at < stream->out.len;
+}
+// the next whole message in in, 0 when there is none yet
+u8 stream_next(Stream *stream, const u8 **body, size_t *len);
+// reads n varints from a message body, false when it is too short
+bool stream_args(const u8 *body, size_t len, u64 *args, u32 n);
+
+void stream_stroke(Stream *stream, i32 from, i32 to, u8 type, u32 radius, i32 shape);
+void stream_reset(Stream *stream);
+
+void new_sent(Sent *sent, const struct Grid *grid);
+void free_sent(const Sent *sent);
+// call after every tick and paint, marks the chunks they could have changed
+void mark_sent(Sent *sent, const struct Grid *grid);
+// queues every cell, or only what changed since the last frame
+void stream_key(Stream *stream, Sent *sent, const struct Grid *grid);
+void stream_delta(Stream *stream, Sent *sent, const struct Grid *grid);
+
+void free_view(const View *view);
+// applies a STREAM_KEY or STREAM_DELTA, false when it doesn't fit the view
+bool apply_frame(View *view, u8 op, const u8 *body, size_t len);
+
+#endif //CAND_STREAM_H
@@ -0,0 +1,128 @@
+#include <signal.h>
+#include <stdlib.h>
+#include "raylib.h"
+#include "raymath.h"
+#include "types.h"
+#include "sim.h"
+#include "stream.h"
+
+// Thin viewer for server.c, draws the frames it is sent and sends the brush back
+//   usage: viewer [addr]
+//   left mouse paints, the wheel sizes the brush, 1-9 pick the material, R resets
+
+const i32 VIEW_WIDTH  = 800;
+const i32 VIEW_HEIGHT = 600;
+
+// EMPTY is BLANK
+static Color cell_color(const u8 cell) {
+    const Material *m = &MATERIALS[cell];
+    return (Color){ m->color.r, m->color.g, m->color.b, m->color.a };
+}
+
+// mirrored on both axes like the game, so cell i is pixel len - 1 - i
+static void draw_view(const View *view, Color *pixels) {
+    const Color smoke = cell_color(GAS_WHITE);
+    Color *px = &pixels[view->width * view->height - 1];
+    for (u32 y = 0, i = 0; y < view->height; ++y) {
+        for (u32 x = 0; x < view->width; ++x, ++i, --px) {
+            const u16 d = view->cells[i] ? 0 : gas_at(view->gas.d, &view->gas, x, y);
+            *px = d ? (Color){ smoke.r, smoke.g, smoke.b, (u8)(d * 255 / GAS_MAX) } : cell_color(view->cells[i]);
+        }
+    }
+}
+
+i32 main(const i32 argc, char **argv) {
+    const char *addr = argc > 1 ? argv[1] : STREAM_ADDR;
+    Stream server;
+    if (!stream_connect(&server, addr)) {
+        TraceLog(LOG_ERROR, "viewer: cannot connect to %s", addr);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    InitWindow(VIEW_WIDTH, VIEW_HEIGHT, "cand viewer");
+    SetTargetFPS(60);
+
+    View view = {0};
+    Texture2D tex = {0};
+    Color *pixels = NULL;
+    u32 tex_w = 0, tex_h = 0;
+    u8 type = SOLID_WHITE;
+    u32 radius = 3;
+    i32 last = -1;
+    bool alive = true;
+    u64 got = 0;
+    f64 rate = 0, rate_time = GetTime();
+
+    while (!WindowShouldClose()) {
+        if (alive) alive = stream_pump(&server);
+        const u8 *body;
+        size_t len;
+        u8 op;
+        while ((op = stream_next(&server, &body, &len))) {
+            got += len + 5;
+            if (!apply_frame(&view, op, body, len)) TraceLog(LOG_WARNING, "viewer: bad frame %d", op);
+        }
+        if (GetTime() - rate_time >= 1.0) {
+            rate = (f64)got / (GetTime() - rate_time);
+            got = 0;
+            rate_time = GetTime();
+        }
+
+        BeginDrawing();
+        ClearBackground(BLACK);
+        if (view.cells) {
+            if (view.width != tex_w || view.height != tex_h) {
+                if (pixels) UnloadTexture(tex);
+                free(pixels);
+                tex_w = view.width;
+                tex_h = view.height;
+                pixels = calloc((size_t)tex_w * tex_h, sizeof(Color));
+                tex = LoadTextureFromImage((Image){
+                    .data = pixels,
+                    .width = tex_w,
+                    .height = tex_h,
+                    .mipmaps = 1,
+                    .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+                });
+            }
+            const f32 sx = (f32)VIEW_WIDTH / tex_w, sy = (f32)VIEW_HEIGHT / tex_h;
+            const f32 scale = sx < sy ? sx : sy;
+
+            // the cell under the mouse, mirrored like the drawing
+            const Vector2 mouse = GetMousePosition();
+            const i32 mx = (i32)tex_w - 1 - (i32)(mouse.x / scale);
+            const i32 my = (i32)tex_h - 1 - (i32)(mouse.y / scale);
+            const bool on = mouse.x >= 0 && mouse.y >= 0 && mx >= 0 && my >= 0;
+            const i32 hovered = on ? mx + my * (i32)tex_w : -1;
+
+            radius = (u32)Clamp((f32)radius + GetMouseWheelMove(), 1.f, 100.f);
+            for (u8 m = 1; m < MATERIALS_LEN && m <= 9; ++m) {
+                if (IsKeyPressed(KEY_ZERO + m)) type = m;
+            }
+            if (IsKeyPressed(KEY_R)) stream_reset(&server);
+            // strokes are joined up with where the mouse was last frame, as in the game
+            if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) && hovered >= 0) {
+                stream_stroke(&server, last, hovered, type, radius, BRUSH_CIRCLE);
+                last = hovered;
+            } else {
+                last = -1;
+            }
+
+            draw_view(&view, pixels);
+            UpdateTexture(tex, pixels);
+            DrawTextureEx(tex, (Vector2){ 0, 0 }, 0.f, scale, WHITE);
+            if (on) DrawCircleLines((i32)mouse.x, (i32)mouse.y, ((f32)radius - 0.5f) * scale, GRAY);
+        }
+        DrawText(TextFormat("tick %llu  %s  brush %u  %.1f KiB/s%s", (unsigned long long)view.tick,
+            MATERIALS[type].name, radius, rate / 1024.0, alive ? "" : "  disconnected"), 10, 10, 20, LIGHTGRAY);
+        EndDrawing();
+    }
+
+    if (pixels) UnloadTexture(tex);
+    free(pixels);
+    free_view(&view);
+    stream_close(&server);
+    CloseWindow();
+    return 0;
+}
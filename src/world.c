@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+#include "world.h"
+
+#define PAGE_BYTES (PAGE_CELLS * (sizeof(u16) + sizeof(u8) + sizeof(u8)))
+
+// pow first so it stays aligned
+static inline u16 *page_pow(u8 *buf)  { return (u16 *)buf; }
+static inline u8  *page_data(u8 *buf) { return buf + PAGE_CELLS * sizeof(u16); }
+static inline u8  *page_dir(u8 *buf)  { return buf + PAGE_CELLS * (sizeof(u16) + sizeof(u8)); }
+
+static void page_path(const World *world, const u32 px, const u32 py, char *path, const size_t len) {
+    snprintf(path, len, "%s/%u_%u.page", world->cache, px, py);
+}
+
+bool start_world(World *world, Grid *grid, const u32 view_w, const u32 view_h, const u32 max_frozen,
+    const char *cache) {
+    const i32 pbb = (i32)(grid->buff_pbb + 0.5f);
+    if (pbb < 1) return false;
+    const u32 view_pw = (view_w / pbb + PAGE_SIZE - 1) / PAGE_SIZE;
+    const u32 view_ph = (view_h / pbb + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    *world = (World){
+        .grid = grid,
+        .want = world->want,
+        .win_w = view_pw + WINDOW_MARGIN * 2,
+        .win_h = view_ph + WINDOW_MARGIN * 2,
+        .max_frozen = max_frozen,
+    };
+    world->pages_w = view_pw * WORLD_SCALE > world->win_w ? view_pw * WORLD_SCALE : world->win_w;
+    world->pages_h = view_ph * WORLD_SCALE > world->win_h ? view_ph * WORLD_SCALE : world->win_h;
+    world->ox = (world->pages_w - world->win_w) / 2;
+    world->pages = calloc((size_t)world->pages_w * world->pages_h, sizeof(Page));
+    if (!world->pages) return false;
+    snprintf(world->cache, sizeof(world->cache), "%s", cache);
+#ifdef _WIN32
+    _mkdir(world->cache);
+#else
+    mkdir(world->cache, 0755);
+#endif
+
+    stop_recording(grid);
+    grid->px_width  = world->win_w * PAGE_SIZE * (u32)pbb;
+    grid->px_height = world->win_h * PAGE_SIZE * (u32)pbb;
+    grid->buff_pbb  = (f32)pbb;
+    reset_data(grid);
+    for (u32 y = 0; y < world->win_h; ++y) {
+        for (u32 x = 0; x < world->win_w; ++x) {
+            world->pages[(world->oy + y) * world->pages_w + world->ox + x].state = PAGE_ACTIVE;
+        }
+    }
+    world->on = true;
+    return true;
+}
+
+void stop_world(World *world) {
+    if (!world->on) return;
+    char path[300];
+    for (u32 p = 0; p < world->pages_w * world->pages_h; ++p) {
+        free(world->pages[p].buf);
+        if (world->pages[p].state != PAGE_SPILLED) continue;
+        page_path(world, p % world->pages_w, p / world->pages_w, path, sizeof(path));
+        remove(path);
+    }
+    free(world->pages);
+    world->pages = NULL;
+    world->on = false;
+}
+
+// copies the cells of the window page at x, y out of the grid and freezes it
+static void store_page(World *world, const u32 x, const u32 y) {
+    const Grid *grid = world->grid;
+    Page *page = &world->pages[(world->oy + y) * world->pages_w + world->ox + x];
+    const u32 from = y * PAGE_SIZE * grid->width + x * PAGE_SIZE;
+
+    bool any = false;
+    for (u32 r = 0; r < PAGE_SIZE && !any; ++r) {
+        const u8 *row = &grid->data[from + r * grid->width];
+        for (u32 c = 0; c < PAGE_SIZE; ++c) any |= row[c] != 0;
+    }
+    page->state = PAGE_EMPTY;
+    if (!any) return;
+    if (!(page->buf = malloc(PAGE_BYTES))) return;
+
+    for (u32 r = 0; r < PAGE_SIZE; ++r) {
+        const u32 i = from + r * grid->width;
+        memcpy(&page_data(page->buf)[r * PAGE_SIZE], &grid->data[i], PAGE_SIZE * sizeof(u8));
+        memcpy(&page_dir(page->buf)[r * PAGE_SIZE],  &grid->dir[i],  PAGE_SIZE * sizeof(u8));
+        memcpy(&page_pow(page->buf)[r * PAGE_SIZE],  &grid->pow[i],  PAGE_SIZE * sizeof(u16));
+    }
+    page->state = PAGE_FROZEN;
+    page->used  = world->clock++;
+    world->frozen++;
+}
+
+// a page from the cache only holds cells and momentum the step could have made
+static bool valid_page(u8 *buf) {
+    const u8  *data = page_data(buf);
+    const u8  *dir  = page_dir(buf);
+    const u16 *pow  = page_pow(buf);
+    for (u32 c = 0; c < PAGE_CELLS; ++c) {
+        if (data[c] >= MATERIALS_LEN || (flags_of(data[c]) & GAS)) return false;
+        if (!valid_momentum(dir[c], pow[c])) return false;
+    }
+    return true;
+}
+
+// copies the page at x, y of the window into the grid, which is empty there
+static void load_page(World *world, const u32 x, const u32 y) {
+    Grid *grid = world->grid;
+    const u32 px = world->ox + x, py = world->oy + y;
+    Page *page = &world->pages[py * world->pages_w + px];
+    const PageState state = page->state;
+    page->state = PAGE_ACTIVE;
+    if (state == PAGE_EMPTY) return;
+
+    if (state == PAGE_SPILLED) {
+        char path[300];
+        page_path(world, px, py, path, sizeof(path));
+        FILE *file = fopen(path, "rb");
+        page->buf = malloc(PAGE_BYTES);
+        const bool read = file && page->buf && fread(page->buf, 1, PAGE_BYTES, file) == PAGE_BYTES;
+        if (file) fclose(file);
+        remove(path);
+        world->spilled--;
+        // a page that can't be read back is lost, the counts only see what arrives
+        if (!read || !valid_page(page->buf)) {
+            free(page->buf);
+            page->buf = NULL;
+            return;
+        }
+    } else {
+        world->frozen--;
+    }
+
+    const u32 from = y * PAGE_SIZE * grid->width + x * PAGE_SIZE;
+    const u8  *data = page_data(page->buf);
+    const u8  *dir  = page_dir(page->buf);
+    const u16 *pow  = page_pow(page->buf);
+    for (u32 r = 0; r < PAGE_SIZE; ++r) {
+        const u32 i = from + r * grid->width;
+        memcpy(&grid->data[i], &data[r * PAGE_SIZE], PAGE_SIZE * sizeof(u8));
+        memcpy(&grid->dir[i],  &dir[r * PAGE_SIZE],  PAGE_SIZE * sizeof(u8));
+        memcpy(&grid->pow[i],  &pow[r * PAGE_SIZE],  PAGE_SIZE * sizeof(u16));
+    }
+    for (u32 c = 0; c < PAGE_CELLS; ++c) {
+        if (!data[c]) continue;
+        grid->num++;
+        grid->pop[data[c]]++;
+    }
+    free(page->buf);
+    page->buf = NULL;
+}
+
+// writes the oldest frozen pages to the cache until at most max_frozen are left,
+//   a page that fails to write stays frozen rather than being lost
+static void spill_pages(World *world) {
+    char path[300];
+    while (world->frozen > world->max_frozen) {
+        Page *oldest = NULL;
+        u32 at = 0;
+        for (u32 p = 0; p < world->pages_w * world->pages_h; ++p) {
+            Page *page = &world->pages[p];
+            if (page->state != PAGE_FROZEN || (oldest && page->used >= oldest->used)) continue;
+            oldest = page;
+            at = p;
+        }
+        if (!oldest) return;
+
+        page_path(world, at % world->pages_w, at / world->pages_w, path, sizeof(path));
+        FILE *file = fopen(path, "wb");
+        const bool wrote = file && fwrite(oldest->buf, 1, PAGE_BYTES, file) == PAGE_BYTES;
+        if (file && fclose(file) != 0) return;
+        if (!wrote) return;
+        free(oldest->buf);
+        oldest->buf   = NULL;
+        oldest->state = PAGE_SPILLED;
+        world->frozen--;
+        world->spilled++;
+    }
+}
+
+bool world_follow(World *world, const i32 x, const i32 y) {
+    if (!world->on) return false;
+    // the page the cell is on, and where the window would be with it in the middle
+    const i32 cx = x < 0 ? 0 : x / PAGE_SIZE;
+    const i32 cy = y < 0 ? 0 : y / PAGE_SIZE;
+    const i32 mx = (i32)(world->ox + world->win_w / 2);
+    const i32 my = (i32)(world->oy + world->win_h / 2);
+    if (abs(cx - mx) <= 1 && abs(cy - my) <= 1) return false;
+
+    i32 ox = cx - (i32)world->win_w / 2;
+    i32 oy = cy - (i32)world->win_h / 2;
+    if (ox > (i32)(world->pages_w - world->win_w)) ox = (i32)(world->pages_w - world->win_w);
+    if (oy > (i32)(world->pages_h - world->win_h)) oy = (i32)(world->pages_h - world->win_h);
+    if (ox < 0) ox = 0;
+    if (oy < 0) oy = 0;
+    if ((u32)ox == world->ox && (u32)oy == world->oy) return false;
+
+    // the whole window is swapped, a shift only happens every few pages of panning
+    for (u32 py = 0; py < world->win_h; ++py) {
+        for (u32 px = 0; px < world->win_w; ++px) store_page(world, px, py);
+    }
+
+    Grid *grid = world->grid;
+    memset(grid->data, 0, grid->len * sizeof(u8));
+    memset(grid->dir, 0, grid->len * sizeof(u8));
+    memset(grid->pow, 0, grid->len * sizeof(u16));
+    memset(grid->pop, 0, sizeof(grid->pop));
+    grid->num = 0;
+    // gas thins out in seconds anyway, it isn't paged
+    clear_gas(&grid->gas);
+    grid->brush.last = -1;
+
+    world->ox = (u32)ox;
+    world->oy = (u32)oy;
+    for (u32 py = 0; py < world->win_h; ++py) {
+        for (u32 px = 0; px < world->win_w; ++px) load_page(world, px, py);
+    }
+    // pages come back without their sleep state, they settle again
+    memset(grid->chunks.next, 1, grid->chunks.len);
+    spill_pages(world);
+    return true;
+}
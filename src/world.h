@@ -0,0 +1,72 @@
+#ifndef CAND_WORLD_H
+#define CAND_WORLD_H
+#include <stdbool.h>
+#include "types.h"
+#include "sim.h"
+
+// A world much larger than the grid, cut into pages of PAGE_SIZE cells a side.
+// The grid is a window of pages around the camera and is stepped as usual, the
+// pages outside of it are frozen: kept in memory up to max_frozen, then spilled
+// to a file each in the cache directory, and copied back in when the window
+// comes over them again. Pages that never held a cell are never allocated
+/*
+    +-------------------------+   world, pages_w x pages_h pages, y = 0 the floor
+    |        frozen           |
+    |     +---------+         |
+    |     | window  |         |   the grid, win_w x win_h pages from page ox, oy
+    |     +---------+         |
+    |  spilled                |
+    +-------------------------+
+*/
+
+#define PAGE_SIZE  (CHUNK_SIZE * 4)
+#define PAGE_CELLS (PAGE_SIZE * PAGE_SIZE)
+// the world is this many views across and up
+#define WORLD_SCALE 10
+// pages the window keeps past the view on every side, the camera can wander
+//   one page from the middle before the window follows
+#define WINDOW_MARGIN 2
+
+typedef enum PageState {
+    PAGE_EMPTY,    // no cells, nothing allocated
+    PAGE_ACTIVE,   // in the window, the cells live in the grid
+    PAGE_FROZEN,   // in memory
+    PAGE_SPILLED,  // in the cache directory
+} PageState;
+
+typedef struct Page {
+    u8  *buf;   // data, dir and pow of the cells back to back, only while frozen
+    u64 used;   // when it was frozen, the oldest spills first
+    u8  state;  // PageState
+} Page;
+
+typedef struct World {
+    Grid *grid;
+    Page *pages;
+    u32 pages_w;
+    u32 pages_h;
+    u32 ox, oy;        // page under grid cell 0
+    u32 win_w, win_h;  // size of the grid in pages
+    u32 frozen;
+    u32 spilled;
+    u32 max_frozen;
+    u64 clock;
+    char cache[256];
+    bool on;
+    bool want;  // set from the gui, applied by the render loop
+} World;
+
+// resizes the grid to a window for a view of view_w x view_h pixels at the grid's
+//   pbb and starts an empty world of WORLD_SCALE views each way, the window is
+//   put in the middle of the floor. Stops any recording, a log can't follow paging
+bool start_world(World *world, Grid *grid, u32 view_w, u32 view_h, u32 max_frozen, const char *cache);
+// frees every page and the cache files, the grid keeps the window
+void stop_world(World *world);
+
+// moves the window so the world cell x, y is near its middle, true when it moved
+bool world_follow(World *world, i32 x, i32 y);
+
+static inline u32 world_width(const World *world)  { return world->pages_w * PAGE_SIZE; }
+static inline u32 world_height(const World *world) { return world->pages_h * PAGE_SIZE; }
+
+#endif //CAND_WORLD_H